@@ -0,0 +1,310 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Throughput and latency of the binding's operations over synthetic data.
+//
+//   npm run bench -- --sizes=1e5,1e6,1e7 --storage=memory,disk --data=uniform,clustered
+//
+// Each combination is bulk loaded, then queried, inserted into and deleted
+// from, and the results are written as JSON to --out (bench-results.json).
+
+var fs = require('fs'),
+  os = require('os'),
+  path = require('path'),
+  sidx = require('bindings')('spatialindex');
+
+var defaults = {
+  "sizes": "1e5",
+  "storage": "memory,disk",
+  "data": "uniform,clustered",
+  "ops": "10000",
+  "batch": "1000",
+  "concurrency": "64",
+  "results": "100",
+  "k": "10",
+  "threads": "0",
+  "seed": "42",
+  "out": "bench-results.json"
+};
+
+// the data covers [0, WORLD) on each axis
+var WORLD = 10000;
+var CLUSTERS = 50;
+var PAYLOAD = 8;
+
+function parseArgs(argv){
+  var args = {};
+  Object.keys(defaults).forEach(function(k){
+    args[k] = defaults[k];
+  });
+  argv.forEach(function(arg){
+    var m = /^--([^=]+)=(.*)$/.exec(arg);
+    if (!m || !(m[1] in defaults)){
+      throw new Error("Unknown argument " + arg + ", expected one of --" + Object.keys(defaults).join("=, --") + "=");
+    }
+    args[m[1]] = m[2];
+  });
+  var list = function(v){ return v.split(",").filter(function(s){ return s.length > 0; }); };
+  return {
+    sizes: list(args.sizes).map(Number),
+    storage: list(args.storage),
+    data: list(args.data),
+    ops: Number(args.ops),
+    batch: Number(args.batch),
+    concurrency: Number(args.concurrency),
+    results: Number(args.results),
+    k: Number(args.k),
+    threads: Number(args.threads),
+    seed: Number(args.seed),
+    out: args.out
+  };
+}
+
+// mulberry32, so every run draws the same data for a seed
+function random(seed){
+  var a = seed >>> 0;
+  return function(){
+    a = (a + 0x6D2B79F5) >>> 0;
+    var t = a;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+// boxes of up to one unit, uniform over the world or normally distributed
+// around a few cluster centres
+function generate(n, distribution, firstId, rand){
+  var ids = new Float64Array(n);
+  var mins = new Float64Array(2 * n);
+  var maxs = new Float64Array(2 * n);
+  var offsets = new Uint32Array(n + 1);
+  var data = Buffer.alloc(n * PAYLOAD);
+  var centres = [];
+  for (var c = 0; c < CLUSTERS; c++){
+    centres.push([rand() * WORLD, rand() * WORLD]);
+  }
+  var gaussian = function(){
+    return Math.sqrt(-2 * Math.log(1 - rand())) * Math.cos(2 * Math.PI * rand());
+  };
+  for (var i = 0; i < n; i++){
+    var x, y;
+    if (distribution == "clustered"){
+      var centre = centres[Math.floor(rand() * CLUSTERS)];
+      x = Math.min(Math.max(centre[0] + gaussian() * WORLD / 100, 0), WORLD - 1);
+      y = Math.min(Math.max(centre[1] + gaussian() * WORLD / 100, 0), WORLD - 1);
+    } else {
+      x = rand() * (WORLD - 1);
+      y = rand() * (WORLD - 1);
+    }
+    ids[i] = firstId + i;
+    mins[2 * i] = x;
+    mins[2 * i + 1] = y;
+    maxs[2 * i] = x + rand();
+    maxs[2 * i + 1] = y + rand();
+    data.writeDoubleLE(firstId + i, i * PAYLOAD);
+    offsets[i + 1] = (i + 1) * PAYLOAD;
+  }
+  return {ids: ids, mins: mins, maxs: maxs, payloads: {offsets: offsets, data: data}};
+}
+
+function promise(fn){
+  return new Promise(function(resolve, reject){
+    fn(function(err, result){
+      if (err){
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function now(){
+  return Number(process.hrtime.bigint()) / 1e6;
+}
+
+function summarize(op, latencies, wallMs, items){
+  var sorted = Float64Array.from(latencies).sort();
+  var at = function(p){
+    return sorted.length ? sorted[Math.min(sorted.length - 1, Math.floor(p * sorted.length))] : 0;
+  };
+  var total = sorted.reduce(function(a, b){ return a + b; }, 0);
+  return {
+    op: op,
+    ops: sorted.length,
+    items: items,
+    wallMs: wallMs,
+    opsPerSec: sorted.length / (wallMs / 1000),
+    itemsPerSec: items / (wallMs / 1000),
+    latencyMs: {
+      mean: sorted.length ? total / sorted.length : 0,
+      p50: at(0.5),
+      p90: at(0.9),
+      p99: at(0.99),
+      p999: at(0.999),
+      max: sorted.length ? sorted[sorted.length - 1] : 0
+    }
+  };
+}
+
+// issues count calls of call(i, cb), keeping up to concurrency of them in flight
+function measure(op, count, concurrency, itemsPerOp, call){
+  return new Promise(function(resolve, reject){
+    var latencies = new Float64Array(count);
+    var issued = 0;
+    var completed = 0;
+    var failed = false;
+    var start = now();
+    var next = function(){
+      var i = issued++;
+      var t = now();
+      call(i, function(err){
+        if (failed){
+          return;
+        }
+        if (err){
+          failed = true;
+          return reject(err);
+        }
+        latencies[i] = now() - t;
+        if (++completed == count){
+          resolve(summarize(op, latencies, now() - start, count * itemsPerOp));
+        } else if (issued < count){
+          next();
+        }
+      });
+    };
+    for (var c = 0; (c < concurrency) && (c < count); c++){
+      next();
+    }
+  });
+}
+
+function slice(items, from, to){
+  return {
+    ids: items.ids.subarray(from, to),
+    mins: items.mins.subarray(2 * from, 2 * to),
+    maxs: items.maxs.subarray(2 * from, 2 * to)
+  };
+}
+
+async function run(args, size, storage, distribution){
+  var rand = random(args.seed);
+  var base = generate(size, distribution, 0, rand);
+  var extra = generate(args.ops, distribution, size, rand);
+  var batches = Math.max(1, Math.floor(args.ops / args.batch));
+  var many = generate(batches * args.batch, distribution, size + args.ops, rand);
+  // windows sized to hold about args.results items of uniform data
+  var side = WORLD * Math.sqrt(args.results / size);
+  var windows = new Float64Array(2 * args.ops);
+  for (var w = 0; w < windows.length; w++){
+    windows[w] = rand() * (WORLD - side);
+  }
+  var buf = Buffer.alloc(PAYLOAD);
+
+  var options = {"threads": args.threads};
+  var filename = null;
+  if (storage == "disk"){
+    filename = path.join(os.tmpdir(), "nodesidx-bench-" + process.pid);
+    options.storage = "disk";
+    options.filename = filename;
+  }
+
+  var results = [];
+  var start = now();
+  var index = await promise(function(cb){ sidx.SpatialIndex.bulkLoad(options, base, cb); });
+  var loadMs = now() - start;
+  results.push(summarize("bulkLoad", [loadMs], loadMs, size));
+
+  var c = args.concurrency;
+  results.push(await measure("intersectsIds", args.ops, c, 1, function(i, cb){
+    var x = windows[2 * i], y = windows[2 * i + 1];
+    index.intersectsIds([x, y], [x + side, y + side], cb);
+  }));
+  results.push(await measure("intersects", args.ops, c, 1, function(i, cb){
+    var x = windows[2 * i], y = windows[2 * i + 1];
+    index.intersects([x, y], [x + side, y + side], cb);
+  }));
+  results.push(await measure("nearest", args.ops, c, 1, function(i, cb){
+    index.nearest([windows[2 * i], windows[2 * i + 1]], args.k, cb);
+  }));
+  results.push(await measure("insert", args.ops, c, 1, function(i, cb){
+    index.insert(extra.ids[i], [extra.mins[2 * i], extra.mins[2 * i + 1]],
+      [extra.maxs[2 * i], extra.maxs[2 * i + 1]], buf, cb);
+  }));
+  results.push(await measure("insertMany", batches, c, args.batch, function(i, cb){
+    var b = slice(many, i * args.batch, (i + 1) * args.batch);
+    index.insertMany(b.ids, b.mins, b.maxs, null, cb);
+  }));
+  results.push(await measure("delete", args.ops, c, 1, function(i, cb){
+    index.delete(extra.ids[i], [extra.mins[2 * i], extra.mins[2 * i + 1]],
+      [extra.maxs[2 * i], extra.maxs[2 * i + 1]], cb);
+  }));
+
+  await promise(function(cb){ index.close(cb); });
+  if (filename !== null){
+    [".idx", ".dat"].forEach(function(ext){
+      try { fs.unlinkSync(filename + ext); } catch (e) {}
+    });
+  }
+  return results.map(function(r){
+    r.storage = storage;
+    r.distribution = distribution;
+    r.size = size;
+    return r;
+  });
+}
+
+async function main(){
+  var args = parseArgs(process.argv.slice(2));
+  var version = await promise(function(cb){ new sidx.SpatialIndex().version(cb); });
+  var report = {
+    date: new Date().toISOString(),
+    libspatialindex: version,
+    node: process.version,
+    platform: os.platform() + " " + os.arch(),
+    cpus: os.cpus().length + " x " + (os.cpus()[0] ? os.cpus()[0].model : "unknown"),
+    args: args,
+    results: []
+  };
+  for (var size of args.sizes){
+    for (var storage of args.storage){
+      for (var distribution of args.data){
+        var results = await run(args, size, storage, distribution);
+        results.forEach(function(r){
+          console.log([r.storage, r.distribution, r.size, r.op].join(" ") + ": " +
+            Math.round(r.itemsPerSec) + " items/s, p50 " + r.latencyMs.p50.toFixed(3) +
+            " ms, p99 " + r.latencyMs.p99.toFixed(3) + " ms");
+        });
+        report.results = report.results.concat(results);
+        if (global.gc){
+          global.gc();
+        }
+      }
+    }
+  }
+  fs.writeFileSync(args.out, JSON.stringify(report, null, 2));
+  console.log("wrote " + args.out);
+}
+
+main().catch(function(err){
+  console.error(err);
+  process.exit(1);
+});
@@ -33,9 +33,11 @@
         ]
       ],
       'include_dirs': [
-        "<!(node -e \"require('nan')\")",
         'deps/libspatialindex/include'
       ],
+      'defines': [
+        'NAPI_VERSION=6'
+      ],
       'sources': [
         'src/spatialindex.cc',
         'src/libsidxjs.cc'
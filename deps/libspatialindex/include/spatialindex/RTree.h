@@ -75,6 +75,30 @@ namespace SpatialIndex
 			uint32_t m_dataLength;
 		}; // Data
 
+		// Where a bounded query stopped: the nodes it has still to visit and, in the
+		// leaf it stopped in, the next child. Handed back to resumeIntersectsWithQuery
+		// the query carries on from there instead of starting over. If the tree has
+		// been written in between, the node identifiers kept may name other nodes, so
+		// the query starts again from the root and skips the entries it has visited,
+		// told apart by identifier, MBR and data.
+		class SIDX_DLL QueryPosition
+		{
+		public:
+			QueryPosition();
+
+			bool m_bStarted;
+			bool m_bResumable;
+				// false for a query run once; it then keeps no entries.
+			std::vector<id_type> m_pending;
+			id_type m_leaf;
+			uint32_t m_child;
+			uint64_t m_modifications;
+			std::vector<std::string> m_visited;
+				// every entry given to the visitor.
+			std::multiset<std::string> m_skipped;
+				// the entries visited before the query last started over, and not met again since.
+		}; // QueryPosition
+
 		SIDX_DLL ISpatialIndex* returnRTree(IStorageManager& ind, Tools::PropertySet& in);
 		SIDX_DLL ISpatialIndex* createNewRTree(
 			IStorageManager& sm,
@@ -94,7 +118,8 @@ namespace SpatialIndex
 			uint32_t leafCapacity,
 			uint32_t dimension,
 			RTreeVariant rv,
-			id_type& indexIdentifier
+			id_type& indexIdentifier,
+			bool bResidentNodes = false
 		);
 		SIDX_DLL ISpatialIndex* createAndBulkLoadNewRTree(
 			BulkLoadMethod m,
@@ -104,5 +129,6 @@ namespace SpatialIndex
 			id_type& indexIdentifier
 		);
 		SIDX_DLL ISpatialIndex* loadRTree(IStorageManager& in, id_type indexIdentifier);
+		SIDX_DLL void resumeIntersectsWithQuery(ISpatialIndex& index, const IShape& query, IVisitor& v, QueryPosition& position);
 	}
 }
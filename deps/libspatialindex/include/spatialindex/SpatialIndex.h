@@ -171,6 +171,14 @@ namespace SpatialIndex
 		virtual ~IVisitor() {}
 	}; // IVisitor
 
+	class SIDX_DLL IBoundedVisitor : public IVisitor
+	{
+	public:
+		// checked after each visited data entry, queries stop once it returns true.
+		virtual bool isDone() const = 0;
+		virtual ~IBoundedVisitor() {}
+	}; // IBoundedVisitor
+
 	class SIDX_DLL IQueryStrategy
 	{
 	public:
@@ -188,6 +196,20 @@ namespace SpatialIndex
 		virtual ~IStatistics() {}
 	}; // IStatistics
 
+	class SIDX_DLL ITreeStatistics : public IStatistics
+	{
+	public:
+		// the counters kept by all the tree variants.
+		virtual uint64_t getSplits() const = 0;
+		virtual uint64_t getHits() const = 0;
+		virtual uint64_t getMisses() const = 0;
+		virtual uint64_t getAdjustments() const = 0;
+		virtual uint64_t getQueryResults() const = 0;
+		virtual uint32_t getTreeHeight() const = 0;
+		virtual uint32_t getNumberOfNodesInLevel(uint32_t l) const = 0;
+		virtual ~ITreeStatistics() {}
+	}; // ITreeStatistics
+
 	class SIDX_DLL ISpatialIndex
 	{
 	public:
@@ -54,3 +54,30 @@ private:
 
 };
 
+class SIDX_DLL ArrayStream : public SpatialIndex::IDataStream
+{
+public:
+    // Streams packed arrays without copying them, item i owns the coordinates
+    // [i * nDimension, (i + 1) * nDimension) and the data bytes
+    // [pnDataOffsets[i], pnDataOffsets[i + 1]). pData and pnDataOffsets may be NULL.
+    ArrayStream(uint64_t nItems, uint32_t nDimension, const int64_t* ids,
+                const double* pdMins, const double* pdMaxs,
+                const uint8_t* pData, const uint32_t* pnDataOffsets);
+    ~ArrayStream();
+
+    SpatialIndex::IData* getNext();
+    bool hasNext();
+
+    uint32_t size();
+    void rewind();
+
+private:
+    uint64_t m_nItems;
+    uint32_t m_nDimension;
+    const int64_t* m_ids;
+    const double* m_pdMins;
+    const double* m_pdMaxs;
+    const uint8_t* m_pData;
+    const uint32_t* m_pnDataOffsets;
+    uint64_t m_nNext;
+};
@@ -30,15 +30,20 @@
 
 #include "sidx_export.h"
 
-class SIDX_DLL IdVisitor : public SpatialIndex::IVisitor
+class SIDX_DLL IdVisitor : public SpatialIndex::IBoundedVisitor
 {
 private:
     std::vector<uint64_t> m_vector;
     uint64_t nResults;
+    uint64_t nStart;
+    uint64_t nResultLimit;
+    uint64_t nSeen;
 
 public:
 
     IdVisitor();
+    // keeps only the hits [nStart, nStart + nResultLimit), a limit of 0 keeps all
+    IdVisitor(uint64_t nOffset, uint64_t nLimit);
     ~IdVisitor();
 
     uint64_t GetResultCount() const { return nResults; }
@@ -47,4 +52,5 @@ public:
     void visitNode(const SpatialIndex::INode& n);
     void visitData(const SpatialIndex::IData& d);
     void visitData(std::vector<const SpatialIndex::IData*>& v);
+    bool isDone() const;
 };
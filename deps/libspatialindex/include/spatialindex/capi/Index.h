@@ -36,6 +36,7 @@ class SIDX_DLL Index
 public:
     Index(const Tools::PropertySet& poProperties);
     Index(const Tools::PropertySet& poProperties, int (*readNext)(SpatialIndex::id_type *id, double **pMin, double **pMax, uint32_t *nDimension, const uint8_t **pData, uint32_t *nDataLength));
+    Index(const Tools::PropertySet& poProperties, SpatialIndex::IDataStream& stream);
     ~Index();
 
     const Tools::PropertySet GetProperties() { index().getIndexProperties(m_properties);  return m_properties;}
@@ -68,6 +69,7 @@ private:
     Index();
 
     void Initialize();
+    void BulkLoad(SpatialIndex::IDataStream& stream);
     SpatialIndex::IStorageManager* m_storage;
     SpatialIndex::StorageManager::IBuffer* m_buffer;
     SpatialIndex::ISpatialIndex* m_rtree;
@@ -78,4 +80,5 @@ private:
     SpatialIndex::IStorageManager* CreateStorage();
     SpatialIndex::StorageManager::IBuffer* CreateIndexBuffer(SpatialIndex::IStorageManager& storage);
     SpatialIndex::ISpatialIndex* CreateIndex();
+    bool UseResidentNodes();
 };
@@ -30,15 +30,20 @@
 
 #include "sidx_export.h"
 
-class SIDX_DLL ObjVisitor : public SpatialIndex::IVisitor
+class SIDX_DLL ObjVisitor : public SpatialIndex::IBoundedVisitor
 {
 private:
     std::vector<SpatialIndex::IData*> m_vector;
     uint64_t nResults;
+    uint64_t nStart;
+    uint64_t nResultLimit;
+    uint64_t nSeen;
 
 public:
 
     ObjVisitor();
+    // keeps only the hits [nStart, nStart + nResultLimit), a limit of 0 keeps all
+    ObjVisitor(uint64_t nOffset, uint64_t nLimit);
     ~ObjVisitor();
 
     uint64_t GetResultCount() const { return nResults; }
@@ -47,5 +52,6 @@ public:
     void visitNode(const SpatialIndex::INode& n);
     void visitData(const SpatialIndex::IData& d);
     void visitData(std::vector<const SpatialIndex::IData*>& v);
+    bool isDone() const;
 };
 
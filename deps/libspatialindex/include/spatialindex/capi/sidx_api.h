@@ -41,6 +41,15 @@ SIDX_DLL IndexH Index_CreateWithStream( IndexPropertyH properties,
 										int (*readNext)(int64_t *id, double **pMin, double **pMax, uint32_t *nDimension, const uint8_t **pData, size_t *nDataLength)
 									   );
 
+SIDX_DLL IndexH Index_CreateWithArray( IndexPropertyH properties,
+										uint64_t nItems,
+										uint32_t nDimension,
+										const int64_t* ids,
+										const double* pdMins,
+										const double* pdMaxs,
+										const uint8_t* pData,
+										const uint32_t* pnDataOffsets);
+
 SIDX_DLL void Index_Destroy(IndexH index);
 SIDX_DLL IndexPropertyH Index_GetProperties(IndexH index);
 
@@ -129,6 +138,17 @@ SIDX_DLL RTError Index_Intersects_obj(	IndexH index,
 										IndexItemH** items,
 										uint64_t* nResults);
 
+/* as Index_Intersects_obj, paged by nStart and nResultLimit rather than
+   the index's ResultSetOffset and ResultSetLimit, a limit of 0 is unbounded */
+SIDX_DLL RTError Index_IntersectsPaged_obj(	IndexH index,
+										double* pdMin,
+										double* pdMax,
+										uint32_t nDimension,
+										int64_t nStart,
+										int64_t nResultLimit,
+										IndexItemH** items,
+										uint64_t* nResults);
+
 SIDX_C_DLL RTError Index_TPIntersects_id(  IndexH index,
                     double* pdMin,
                     double* pdMax,
@@ -156,6 +176,17 @@ SIDX_DLL RTError Index_Intersects_id(	IndexH index,
 										int64_t** items,
 										uint64_t* nResults);
 
+/* as Index_Intersects_id, paged by nStart and nResultLimit rather than
+   the index's ResultSetOffset and ResultSetLimit, a limit of 0 is unbounded */
+SIDX_DLL RTError Index_IntersectsPaged_id(	IndexH index,
+										double* pdMin,
+										double* pdMax,
+										uint32_t nDimension,
+										int64_t nStart,
+										int64_t nResultLimit,
+										int64_t** items,
+										uint64_t* nResults);
+
 SIDX_C_DLL RTError Index_TPIntersects_count(	  IndexH index,
                     double* pdMin,
                     double* pdMax,
@@ -180,6 +211,24 @@ SIDX_DLL RTError Index_Intersects_count(	IndexH index,
 										uint32_t nDimension,
 										uint64_t* nResults);
 
+SIDX_DLL RTError Index_Intersects_visit(	IndexH index,
+										double* pdMin,
+										double* pdMax,
+										uint32_t nDimension,
+										IndexVisitorCallback pfnVisit,
+										void* pUserData);
+
+/* like Index_Intersects_visit, but starts where the query last ended on hPosition,
+   or over from the root, skipping the items already visited, if the index has been
+   written since */
+SIDX_DLL RTError Index_Intersects_resume(	IndexH index,
+										double* pdMin,
+										double* pdMax,
+										uint32_t nDimension,
+										IndexPositionH hPosition,
+										IndexVisitorCallback pfnVisit,
+										void* pUserData);
+
 SIDX_C_DLL RTError Index_TPNearestNeighbors_obj(IndexH index,
                       double* pdMin,
                       double* pdMax,
@@ -234,12 +283,35 @@ SIDX_DLL RTError Index_NearestNeighbors_id( IndexH index,
 											int64_t** items,
 											uint64_t* nResults);
 
+SIDX_DLL RTError Index_NearestNeighborsWithin_obj(IndexH index,
+											double* pdMin,
+											double* pdMax,
+											uint32_t nDimension,
+											double dMaxDistance,
+											IndexItemH** items,
+											uint64_t* nResults);
+
+SIDX_DLL RTError Index_NearestNeighborsWithin_id(IndexH index,
+											double* pdMin,
+											double* pdMax,
+											uint32_t nDimension,
+											double dMaxDistance,
+											int64_t** items,
+											uint64_t* nResults);
+
 SIDX_DLL RTError Index_GetBounds(	IndexH index,
 									double** ppdMin,
 									double** ppdMax,
 									uint32_t* nDimension);
 
 
+/* fills pStats with the tree and buffer counters, ppnNodesInLevel is set to
+   nLevels node counts from the leaves up and must be released with Index_Free */
+SIDX_DLL RTError Index_GetStatistics(	IndexH index,
+									IndexStatistics* pStats,
+									uint32_t** ppnNodesInLevel,
+									uint32_t* nLevels);
+
 SIDX_C_DLL RTError Index_GetLeaves( IndexH index,
 									uint32_t* nLeafNodes,
 									uint32_t** nLeafSizes,
@@ -270,6 +342,9 @@ SIDX_DLL RTError IndexItem_GetBounds(	IndexItemH item,
 										double** ppdMax,
 										uint32_t* nDimension);
 
+SIDX_DLL IndexPositionH IndexPosition_Create();
+SIDX_DLL void IndexPosition_Destroy(IndexPositionH hPosition);
+
 SIDX_DLL IndexPropertyH IndexProperty_Create();
 SIDX_DLL void IndexProperty_Destroy(IndexPropertyH hProp);
 
@@ -360,6 +435,8 @@ SIDX_DLL uint64_t IndexProperty_GetResultSetLimit(IndexPropertyH iprop);
 SIDX_C_DLL char* SIDX_Version();
 
 SIDX_C_DLL char* Error_GetLastErrorMsg(void);
+SIDX_C_DLL int Error_GetErrorCount(void);
+SIDX_C_DLL void Error_Reset(void);
 
 IDX_C_END
 
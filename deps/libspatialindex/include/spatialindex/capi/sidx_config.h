@@ -45,6 +45,7 @@
 #endif
 
    #include <windows.h>
+   #define SIDX_THREAD  __declspec(thread)
    #define STRDUP _strdup
    #include <windows.h>
 
@@ -104,6 +105,26 @@ typedef enum
 typedef struct Index *IndexH;
 typedef struct SpatialIndex_IData *IndexItemH;
 typedef struct Tools_PropertySet *IndexPropertyH;
+typedef struct SpatialIndex_RTree_QueryPosition *IndexPositionH;
+
+/* counters reported by Index_GetStatistics */
+typedef struct
+{
+   uint64_t nReads;
+   uint64_t nWrites;
+   uint64_t nSplits;
+   uint64_t nHits;
+   uint64_t nMisses;
+   uint64_t nAdjustments;
+   uint64_t nQueryResults;
+   uint64_t nData;
+   uint64_t nBufferHits;
+   uint32_t nNodes;
+   uint32_t nTreeHeight;
+} IndexStatistics;
+
+/* called for each item a visiting query finds, a non-zero return ends the query */
+typedef int (*IndexVisitorCallback)(int64_t nID, const uint8_t* pData, uint32_t nDataLength, void* pUserData);
 
 
 
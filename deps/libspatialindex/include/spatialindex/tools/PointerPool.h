@@ -36,6 +36,9 @@ namespace Tools
 	public:
 		explicit PointerPool(uint32_t capacity) : m_capacity(capacity)
 		{
+			#if HAVE_PTHREAD_H
+			pthread_mutex_init(&m_lock, NULL);
+			#endif
 			#ifndef NDEBUG
 			m_hits = 0;
 			m_misses = 0;
@@ -59,12 +62,20 @@ namespace Tools
 			#ifndef NDEBUG
 			std::cerr << "Lost pointers: " << m_pointerCount << std::endl;
 			#endif
+
+			#if HAVE_PTHREAD_H
+			pthread_mutex_destroy(&m_lock);
+			#endif
 		}
 
 		PoolPointer<X> acquire()
 		{
 			X* p = 0;
 
+			#if HAVE_PTHREAD_H
+			pthread_mutex_lock(&m_lock);
+			#endif
+
 			if (! m_pool.empty())
 			{
 				p = m_pool.top(); m_pool.pop();
@@ -72,33 +83,42 @@ namespace Tools
 				m_hits++;
 				#endif
 			}
+			#ifndef NDEBUG
 			else
 			{
-				p = new X();
-				#ifndef NDEBUG
 				m_pointerCount++;
 				m_misses++;
-				#endif
 			}
+			#endif
+
+			#if HAVE_PTHREAD_H
+			pthread_mutex_unlock(&m_lock);
+			#endif
+
+			if (p == 0) p = new X();
 
 			return PoolPointer<X>(p, this);
 		}
 
 		void release(X* p)
 		{
-			if (m_pool.size() < m_capacity)
-			{
-				m_pool.push(p);
-			}
-			else
-			{
-				#ifndef NDEBUG
-				--m_pointerCount;
-				#endif
-				delete p;
-			}
+			#if HAVE_PTHREAD_H
+			pthread_mutex_lock(&m_lock);
+			#endif
+
+			bool bPooled = m_pool.size() < m_capacity;
+			if (bPooled) m_pool.push(p);
+			#ifndef NDEBUG
+			else --m_pointerCount;
+			#endif
 
 			assert(m_pool.size() <= m_capacity);
+
+			#if HAVE_PTHREAD_H
+			pthread_mutex_unlock(&m_lock);
+			#endif
+
+			if (! bPooled) delete p;
 		}
 
 		uint32_t getCapacity() const { return m_capacity; }
@@ -111,6 +131,9 @@ namespace Tools
 	private:
 		uint32_t m_capacity;
 		std::stack<X*> m_pool;
+		#if HAVE_PTHREAD_H
+		pthread_mutex_t m_lock;
+		#endif
 
 	#ifndef NDEBUG
 	public:
@@ -408,7 +408,43 @@ namespace Tools
 	private:
 		pthread_mutex_t* m_pLock;
 	}; // LockGuard
+
+	// Holds a reader/writer lock for reading, alongside any other readers.
+	class SIDX_DLL SharedLockGuard
+	{
+	public:
+		SharedLockGuard(pthread_rwlock_t* pLock);
+		~SharedLockGuard();
+
+	private:
+		pthread_rwlock_t* m_pLock;
+	}; // SharedLockGuard
+
+	// Holds a reader/writer lock for writing, excluding everyone else.
+	class SIDX_DLL ExclusiveLockGuard
+	{
+	public:
+		ExclusiveLockGuard(pthread_rwlock_t* pLock);
+		~ExclusiveLockGuard();
+
+	private:
+		pthread_rwlock_t* m_pLock;
+	}; // ExclusiveLockGuard
+
+	// Initializes a reader/writer lock on which a waiting writer holds back
+	// new readers, so a steady stream of readers cannot starve it.
+	SIDX_DLL void initSharedLock(pthread_rwlock_t* pLock);
+	#endif
+
+	// Adds to a counter that readers holding a SharedLockGuard update together.
+	inline void atomicAdd(uint64_t& counter, uint64_t value)
+	{
+	#if HAVE_PTHREAD_H
+		__sync_fetch_and_add(&counter, value);
+	#else
+		counter += value;
 	#endif
+	}
 
 	class SIDX_DLL BufferedFile
 	{
@@ -7,6 +7,13 @@
       'cflags!': [ '-fno-exceptions', '-fno-rtti'],
       'cflags_cc!': [ '-fno-exceptions', '-fno-rtti'],
       'conditions': [
+        ['OS!="win"', {
+          # guards the tree against concurrent workers, as the cmake build does
+          'defines': [ 'HAVE_PTHREAD_H=1' ],
+          'link_settings': {
+            'libraries': [ '-lpthread' ]
+          }
+        }],
         ['OS=="mac"', {
           'xcode_settings': {
             'GCC_ENABLE_CPP_EXCEPTIONS': 'YES',
@@ -111,3 +111,55 @@ void DataStream::rewind()
 	 m_pNext = 0;
 	}
 }
+
+ArrayStream::ArrayStream(uint64_t nItems, uint32_t nDimension, const int64_t* ids,
+						 const double* pdMins, const double* pdMaxs,
+						 const uint8_t* pData, const uint32_t* pnDataOffsets)
+  : m_nItems(nItems),
+    m_nDimension(nDimension),
+    m_ids(ids),
+    m_pdMins(pdMins),
+    m_pdMaxs(pdMaxs),
+    m_pData(pData),
+    m_pnDataOffsets(pnDataOffsets),
+    m_nNext(0)
+{
+}
+
+ArrayStream::~ArrayStream()
+{
+}
+
+SpatialIndex::IData* ArrayStream::getNext()
+{
+	if (m_nNext >= m_nItems) return 0;
+
+	uint64_t i = m_nNext++;
+	SpatialIndex::Region r = SpatialIndex::Region(m_pdMins + i * m_nDimension, m_pdMaxs + i * m_nDimension, m_nDimension);
+
+	uint32_t nDataLength = 0;
+	uint8_t* p_data = 0;
+	if (m_pData != 0 && m_pnDataOffsets != 0)
+	{
+		nDataLength = m_pnDataOffsets[i + 1] - m_pnDataOffsets[i];
+		p_data = const_cast<uint8_t*>(m_pData + m_pnDataOffsets[i]);
+	}
+
+	// the bulk loader expects RTree data entries
+	return new SpatialIndex::RTree::Data(nDataLength, p_data, r, m_ids[i]);
+}
+
+bool ArrayStream::hasNext()
+{
+	return (m_nNext < m_nItems);
+}
+
+uint32_t ArrayStream::size()
+{
+	return static_cast<uint32_t>(m_nItems);
+}
+
+void ArrayStream::rewind()
+{
+	m_nNext = 0;
+}
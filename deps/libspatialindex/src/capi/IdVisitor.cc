@@ -28,7 +28,11 @@
 
 #include <spatialindex/capi/sidx_impl.h>
 
-IdVisitor::IdVisitor(): nResults(0)
+IdVisitor::IdVisitor(): nResults(0), nStart(0), nResultLimit(0), nSeen(0)
+{
+}
+
+IdVisitor::IdVisitor(uint64_t nOffset, uint64_t nLimit): nResults(0), nStart(nOffset), nResultLimit(nLimit), nSeen(0)
 {
 }
 
@@ -44,6 +48,9 @@ void IdVisitor::visitNode(const SpatialIndex::INode& )
 
 void IdVisitor::visitData(const SpatialIndex::IData& d)
 {
+	// hits before the page are counted but not kept
+	if (nSeen++ < nStart) return;
+
 	nResults += 1;
 	
 	m_vector.push_back(d.getIdentifier());
@@ -52,3 +59,8 @@ void IdVisitor::visitData(const SpatialIndex::IData& d)
 void IdVisitor::visitData(std::vector<const SpatialIndex::IData*>& )
 {
 }
+
+bool IdVisitor::isDone() const
+{
+	return nResultLimit != 0 && nResults >= nResultLimit;
+}
@@ -97,15 +97,33 @@ Index::Index(	const Tools::PropertySet& poProperties,
 								uint32_t *nDataLength))
 : m_properties(poProperties)
 {
-	using namespace SpatialIndex;
+	Setup();
+
+	DataStream ds(readNext);
+	BulkLoad(ds);
+}
 
+Index::Index(const Tools::PropertySet& poProperties, SpatialIndex::IDataStream& stream)
+: m_properties(poProperties)
+{
 	Setup();
 
+	BulkLoad(stream);
+}
+
+void Index::BulkLoad(SpatialIndex::IDataStream& stream)
+{
+	using namespace SpatialIndex;
+
+	// the STR loader only builds R-trees, anything else would silently lose
+	// its temporal semantics
+	if (GetIndexType() != RT_RTree)
+		throw std::runtime_error("Index::Index (streaming): "
+								 "Bulk loading is only supported for RT_RTree indexes");
+
 	m_storage = CreateStorage();
 	m_buffer = CreateIndexBuffer(*m_storage);
 
-	DataStream ds(readNext);
-
 	double dFillFactor = 0.7;
 	uint32_t nIdxCapacity = 100;
 	uint32_t nIdxLeafCap = 100;
@@ -178,14 +196,15 @@ Index::Index(	const Tools::PropertySet& poProperties,
 	}
 
 	m_rtree = RTree::createAndBulkLoadNewRTree(	  SpatialIndex::RTree::BLM_STR,
-												  ds,
+												  stream,
 												  *m_buffer,
 												  dFillFactor,
 												  nIdxCapacity,
 												  nIdxLeafCap,
 												  nIdxDimension,
 												  eVariant,
-												  m_IdxIdentifier);
+												  m_IdxIdentifier,
+												  UseResidentNodes());
 }
 
 
@@ -274,9 +293,28 @@ void Index::Initialize()
 {
 	m_storage = CreateStorage();
 	m_buffer = CreateIndexBuffer(*m_storage);
+
+	if (UseResidentNodes())
+	{
+		Tools::Variant var;
+		var.m_varType = Tools::VT_BOOL;
+		var.m_val.blVal = true;
+		m_properties.setProperty("ResidentNodes", var);
+	}
+
 	m_rtree = CreateIndex();
 }
 
+// nothing outlives a memory index, so its R-tree keeps the nodes decoded
+// rather than serializing them to the storage manager.
+bool Index::UseResidentNodes()
+{
+	if (GetIndexType() != RT_RTree || GetIndexStorage() != RT_Memory) return false;
+
+	Tools::Variant var = m_properties.getProperty("IndexIdentifier");
+	return var.m_varType == Tools::VT_EMPTY;
+}
+
 void Index::Setup()
 
 {
@@ -428,5 +466,8 @@ void Index::SetResultSetLimit(int64_t v)
 void Index::flush()
 {
 	m_rtree->flush();
+	// the header and any dirty nodes are held by the buffer until written,
+	// its clean pages stay cached for the next queries
+	m_buffer->flush();
 	m_storage->flush();
 }
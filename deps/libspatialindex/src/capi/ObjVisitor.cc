@@ -28,7 +28,11 @@
 
 #include <spatialindex/capi/sidx_impl.h>
 
-ObjVisitor::ObjVisitor(): nResults(0)
+ObjVisitor::ObjVisitor(): nResults(0), nStart(0), nResultLimit(0), nSeen(0)
+{
+}
+
+ObjVisitor::ObjVisitor(uint64_t nOffset, uint64_t nLimit): nResults(0), nStart(nOffset), nResultLimit(nLimit), nSeen(0)
 {
 }
 
@@ -47,6 +51,8 @@ void ObjVisitor::visitNode(const SpatialIndex::INode& )
 
 void ObjVisitor::visitData(const SpatialIndex::IData& d)
 {
+	// hits before the page are counted but not kept
+	if (nSeen++ < nStart) return;
 
 	SpatialIndex::IData* item = dynamic_cast<SpatialIndex::IData*>(const_cast<SpatialIndex::IData&>(d).clone()) ; 
 	
@@ -59,3 +65,7 @@ void ObjVisitor::visitData(std::vector<const SpatialIndex::IData*>& )
 {
 }
 
+bool ObjVisitor::isDone() const
+{
+	return nResultLimit != 0 && nResults >= nResultLimit;
+}
@@ -30,7 +30,84 @@
 #include <limits>
 #include <spatialindex/capi/sidx_impl.h>
 
-static std::stack<Error> errors;
+// Each thread keeps its own error stack, so concurrent calls from several
+// threads neither lock nor see each other's errors.  The stack is allocated
+// on first use and freed when it is reset.
+static SIDX_THREAD std::stack<Error>* pErrors = 0;
+
+static std::stack<Error>& threadErrors()
+{
+	if (pErrors == 0)
+		pErrors = new std::stack<Error>();
+	return *pErrors;
+}
+
+// Nearest neighbor comparator that places every entry beyond a cutoff at an
+// infinite distance, which the index prunes from its search queue.
+class MaxDistanceComparator : public SpatialIndex::INearestNeighborComparator
+{
+public:
+	MaxDistanceComparator(double dMaxDistance) : m_dMaxDistance(dMaxDistance) {}
+
+	double getMinimumDistance(const SpatialIndex::IShape& query, const SpatialIndex::IShape& entry)
+	{
+		return cutoff(query.getMinimumDistance(entry));
+	}
+
+	double getMinimumDistance(const SpatialIndex::IShape& query, const SpatialIndex::IData& data)
+	{
+		SpatialIndex::IShape* pS;
+		data.getShape(&pS);
+		double ret = query.getMinimumDistance(*pS);
+		delete pS;
+		return cutoff(ret);
+	}
+
+private:
+	double cutoff(double d) const
+	{
+		return (d > m_dMaxDistance) ? std::numeric_limits<double>::infinity() : d;
+	}
+
+	double m_dMaxDistance;
+};
+
+// Visitor that hands each item to a C callback without collecting results, the
+// payload is passed in place and is only valid for the duration of the call.
+class CallbackVisitor : public SpatialIndex::IBoundedVisitor
+{
+public:
+	CallbackVisitor(IndexVisitorCallback pfnVisit, void* pUserData)
+		: m_pfnVisit(pfnVisit), m_pUserData(pUserData), m_bDone(false) {}
+
+	void visitNode(const SpatialIndex::INode& ) {}
+
+	void visitData(const SpatialIndex::IData& d)
+	{
+		const SpatialIndex::RTree::Data* pData = dynamic_cast<const SpatialIndex::RTree::Data*>(&d);
+		if (pData != 0)
+		{
+			m_bDone = m_pfnVisit(pData->m_id, pData->m_pData, pData->m_dataLength, m_pUserData) != 0;
+		}
+		else
+		{
+			uint8_t* pCopy = 0;
+			uint32_t nLength = 0;
+			d.getData(nLength, &pCopy);
+			m_bDone = m_pfnVisit(d.getIdentifier(), pCopy, nLength, m_pUserData) != 0;
+			delete[] pCopy;
+		}
+	}
+
+	void visitData(std::vector<const SpatialIndex::IData*>& ) {}
+
+	bool isDone() const { return m_bDone; }
+
+private:
+	IndexVisitorCallback m_pfnVisit;
+	void* m_pUserData;
+	bool m_bDone;
+};
 
 
 #ifdef _WIN32
@@ -61,49 +138,49 @@ static std::stack<Error> errors;
 IDX_C_START
 
 SIDX_C_DLL void Error_Reset(void) {
-	if (errors.empty()) return;
-	for (std::size_t i=0;i<errors.size();i++) errors.pop();
+	delete pErrors;
+	pErrors = 0;
 }
 
 SIDX_C_DLL void Error_Pop(void) {
-	if (errors.empty()) return;
-	errors.pop();
+	if (pErrors == 0 || pErrors->empty()) return;
+	pErrors->pop();
 }
 
 SIDX_C_DLL int Error_GetLastErrorNum(void){
-	if (errors.empty())
+	if (pErrors == 0 || pErrors->empty())
 		return 0;
 	else {
-		Error err = errors.top();
+		Error err = pErrors->top();
 		return err.GetCode();
 	}
 }
 
 SIDX_C_DLL char* Error_GetLastErrorMsg(void){
-	if (errors.empty())
+	if (pErrors == 0 || pErrors->empty())
 		return NULL;
 	else {
-		Error err = errors.top();
+		Error err = pErrors->top();
 		return STRDUP(err.GetMessage());
 	}
 }
 
 SIDX_C_DLL char* Error_GetLastErrorMethod(void){
-	if (errors.empty())
+	if (pErrors == 0 || pErrors->empty())
 		return NULL;
 	else {
-		Error err = errors.top();
+		Error err = pErrors->top();
 		return STRDUP(err.GetMethod());
 	}
 }
 
 SIDX_C_DLL void Error_PushError(int code, const char *message, const char *method) {
 	Error err = Error(code, std::string(message), std::string(method));
-	errors.push(err);
+	threadErrors().push(err);
 }
 
 SIDX_C_DLL int Error_GetErrorCount(void) {
-	return static_cast<int>(errors.size());
+	return (pErrors == 0) ? 0 : static_cast<int>(pErrors->size());
 }
 
 SIDX_C_DLL IndexH Index_Create(IndexPropertyH hProp)
@@ -165,6 +242,45 @@ SIDX_C_DLL IndexH Index_CreateWithStream( IndexPropertyH hProp,
 	return NULL;
 }
 
+SIDX_C_DLL IndexH Index_CreateWithArray( IndexPropertyH hProp,
+										uint64_t nItems,
+										uint32_t nDimension,
+										const int64_t* ids,
+										const double* pdMins,
+										const double* pdMaxs,
+										const uint8_t* pData,
+										const uint32_t* pnDataOffsets)
+{
+	VALIDATE_POINTER1(hProp, "Index_CreateWithArray", NULL);
+	VALIDATE_POINTER1(ids, "Index_CreateWithArray", NULL);
+	VALIDATE_POINTER1(pdMins, "Index_CreateWithArray", NULL);
+	VALIDATE_POINTER1(pdMaxs, "Index_CreateWithArray", NULL);
+	Tools::PropertySet* prop = reinterpret_cast<Tools::PropertySet*>(hProp);
+
+	try {
+		ArrayStream as(nItems, nDimension, ids, pdMins, pdMaxs, pData, pnDataOffsets);
+		return (IndexH) new Index(*prop, as);
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what().c_str(),
+						"Index_CreateWithArray");
+		return NULL;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what(),
+						"Index_CreateWithArray");
+		return NULL;
+	} catch (...) {
+		Error_PushError(RT_Failure,
+						"Unknown Error",
+						"Index_CreateWithArray");
+		return NULL;
+	}
+	return NULL;
+}
+
 SIDX_C_DLL void Index_Destroy(IndexH index)
 {
 	VALIDATE_POINTER0(index, "Index_Destroy");
@@ -178,7 +294,23 @@ SIDX_C_DLL void Index_Flush(IndexH index)
 	Index* idx = (Index*) index;
 	if (idx)
 	{
-		idx->flush();
+		try {
+			idx->flush();
+		} catch (Tools::Exception& e)
+		{
+			Error_PushError(RT_Failure,
+							e.what().c_str(),
+							"Index_Flush");
+		} catch (std::exception const& e)
+		{
+			Error_PushError(RT_Failure,
+							e.what(),
+							"Index_Flush");
+		} catch (...) {
+			Error_PushError(RT_Failure,
+							"Unknown Error",
+							"Index_Flush");
+		}
 	}
 }
 
@@ -613,27 +745,33 @@ SIDX_C_DLL RTError Index_MVRIntersects_obj(  IndexH index,
   return RT_None;
 }
 
-SIDX_C_DLL RTError Index_Intersects_obj(  IndexH index,
+SIDX_C_DLL RTError Index_IntersectsPaged_obj(  IndexH index,
 										double* pdMin,
 										double* pdMax,
 										uint32_t nDimension,
+										int64_t nStart,
+										int64_t nResultLimit,
 										IndexItemH** items,
 										uint64_t* nResults)
 {
-	VALIDATE_POINTER1(index, "Index_Intersects_obj", RT_Failure);
+	VALIDATE_POINTER1(index, "Index_IntersectsPaged_obj", RT_Failure);
 	Index* idx = reinterpret_cast<Index*>(index);
-	int64_t nResultLimit, nStart;
-
-	nResultLimit = idx->GetResultSetLimit();
-	nStart = idx->GetResultSetOffset();
 
-	ObjVisitor* visitor = new ObjVisitor;
+	// the visitor keeps only the requested page and ends the query once it is full,
+	// an offset without a limit is ignored as in Page_ResultSet_*
+	if (nResultLimit <= 0)
+	{
+		nStart = 0;
+		nResultLimit = 0;
+	}
+	if (nStart < 0) nStart = 0;
+	ObjVisitor* visitor = new ObjVisitor(nStart, nResultLimit);
 	try {
     SpatialIndex::Region* r = new SpatialIndex::Region(pdMin, pdMax, nDimension);
 		idx->index().intersectsWithQuery(	*r,
 											*visitor);
 
-    Page_ResultSet_Obj(*visitor, items, nStart, nResultLimit, nResults);
+    Page_ResultSet_Obj(*visitor, items, 0, 0, nResults);
 
     delete r;
 		delete visitor;
@@ -642,26 +780,40 @@ SIDX_C_DLL RTError Index_Intersects_obj(  IndexH index,
 	{
 		Error_PushError(RT_Failure,
 						e.what().c_str(),
-						"Index_Intersects_obj");
+						"Index_IntersectsPaged_obj");
 		delete visitor;
 		return RT_Failure;
 	} catch (std::exception const& e)
 	{
 		Error_PushError(RT_Failure,
 						e.what(),
-						"Index_Intersects_obj");
+						"Index_IntersectsPaged_obj");
 		delete visitor;
 		return RT_Failure;
 	} catch (...) {
 		Error_PushError(RT_Failure,
 						"Unknown Error",
-						"Index_Intersects_obj");
+						"Index_IntersectsPaged_obj");
 		delete visitor;
 		return RT_Failure;
 	}
 	return RT_None;
 }
 
+SIDX_C_DLL RTError Index_Intersects_obj(  IndexH index,
+										double* pdMin,
+										double* pdMax,
+										uint32_t nDimension,
+										IndexItemH** items,
+										uint64_t* nResults)
+{
+	VALIDATE_POINTER1(index, "Index_Intersects_obj", RT_Failure);
+	Index* idx = reinterpret_cast<Index*>(index);
+
+	return Index_IntersectsPaged_obj(index, pdMin, pdMax, nDimension, idx->GetResultSetOffset(),
+				idx->GetResultSetLimit(), items, nResults);
+}
+
 SIDX_C_DLL RTError Index_TPIntersects_id(  IndexH index,
                     double* pdMin,
                     double* pdMax,
@@ -768,28 +920,33 @@ SIDX_C_DLL RTError Index_MVRIntersects_id(  IndexH index,
   return RT_None;
 }
 
-SIDX_C_DLL RTError Index_Intersects_id(	  IndexH index,
+SIDX_C_DLL RTError Index_IntersectsPaged_id(	  IndexH index,
 										double* pdMin,
 										double* pdMax,
 										uint32_t nDimension,
+										int64_t nStart,
+										int64_t nResultLimit,
 										int64_t** ids,
 										uint64_t* nResults)
 {
-	VALIDATE_POINTER1(index, "Index_Intersects_id", RT_Failure);
+	VALIDATE_POINTER1(index, "Index_IntersectsPaged_id", RT_Failure);
 	Index* idx = reinterpret_cast<Index*>(index);
 
-	int64_t nResultLimit, nStart;
-
-	nResultLimit = idx->GetResultSetLimit();
-  nStart = idx->GetResultSetOffset();
-
-	IdVisitor* visitor = new IdVisitor;
+	// the visitor keeps only the requested page and ends the query once it is full,
+	// an offset without a limit is ignored as in Page_ResultSet_*
+	if (nResultLimit <= 0)
+	{
+		nStart = 0;
+		nResultLimit = 0;
+	}
+	if (nStart < 0) nStart = 0;
+	IdVisitor* visitor = new IdVisitor(nStart, nResultLimit);
 	try {
     SpatialIndex::Region* r = new SpatialIndex::Region(pdMin, pdMax, nDimension);
 		idx->index().intersectsWithQuery(	*r,
 											*visitor);
 
-    Page_ResultSet_Ids(*visitor, ids, nStart, nResultLimit, nResults);
+    Page_ResultSet_Ids(*visitor, ids, 0, 0, nResults);
 
     delete r;
 		delete visitor;
@@ -798,26 +955,40 @@ SIDX_C_DLL RTError Index_Intersects_id(	  IndexH index,
 	{
 		Error_PushError(RT_Failure,
 						e.what().c_str(),
-						"Index_Intersects_id");
+						"Index_IntersectsPaged_id");
 		delete visitor;
 		return RT_Failure;
 	} catch (std::exception const& e)
 	{
 		Error_PushError(RT_Failure,
 						e.what(),
-						"Index_Intersects_id");
+						"Index_IntersectsPaged_id");
 		delete visitor;
 		return RT_Failure;
 	} catch (...) {
 		Error_PushError(RT_Failure,
 						"Unknown Error",
-						"Index_Intersects_id");
+						"Index_IntersectsPaged_id");
 		delete visitor;
 		return RT_Failure;
 	}
 	return RT_None;
 }
 
+SIDX_C_DLL RTError Index_Intersects_id(	  IndexH index,
+										double* pdMin,
+										double* pdMax,
+										uint32_t nDimension,
+										int64_t** ids,
+										uint64_t* nResults)
+{
+	VALIDATE_POINTER1(index, "Index_Intersects_id", RT_Failure);
+	Index* idx = reinterpret_cast<Index*>(index);
+
+	return Index_IntersectsPaged_id(index, pdMin, pdMax, nDimension, idx->GetResultSetOffset(),
+				idx->GetResultSetLimit(), ids, nResults);
+}
+
 SIDX_C_DLL RTError Index_TPIntersects_count(	  IndexH index,
                     double* pdMin,
                     double* pdMax,
@@ -956,6 +1127,81 @@ SIDX_C_DLL RTError Index_Intersects_count(	  IndexH index,
 	return RT_None;
 }
 
+SIDX_C_DLL RTError Index_Intersects_visit(	  IndexH index,
+										double* pdMin,
+										double* pdMax,
+										uint32_t nDimension,
+										IndexVisitorCallback pfnVisit,
+										void* pUserData)
+{
+	VALIDATE_POINTER1(index, "Index_Intersects_visit", RT_Failure);
+	VALIDATE_POINTER1(pfnVisit, "Index_Intersects_visit", RT_Failure);
+	Index* idx = reinterpret_cast<Index*>(index);
+
+	CallbackVisitor visitor(pfnVisit, pUserData);
+	try {
+		SpatialIndex::Region r(pdMin, pdMax, nDimension);
+		idx->index().intersectsWithQuery(r, visitor);
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what().c_str(),
+						"Index_Intersects_visit");
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what(),
+						"Index_Intersects_visit");
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure,
+						"Unknown Error",
+						"Index_Intersects_visit");
+		return RT_Failure;
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_Intersects_resume(	  IndexH index,
+										double* pdMin,
+										double* pdMax,
+										uint32_t nDimension,
+										IndexPositionH hPosition,
+										IndexVisitorCallback pfnVisit,
+										void* pUserData)
+{
+	VALIDATE_POINTER1(index, "Index_Intersects_resume", RT_Failure);
+	VALIDATE_POINTER1(hPosition, "Index_Intersects_resume", RT_Failure);
+	VALIDATE_POINTER1(pfnVisit, "Index_Intersects_resume", RT_Failure);
+	Index* idx = reinterpret_cast<Index*>(index);
+	SpatialIndex::RTree::QueryPosition* position = reinterpret_cast<SpatialIndex::RTree::QueryPosition*>(hPosition);
+
+	CallbackVisitor visitor(pfnVisit, pUserData);
+	try {
+		SpatialIndex::Region r(pdMin, pdMax, nDimension);
+		SpatialIndex::RTree::resumeIntersectsWithQuery(idx->index(), r, visitor, *position);
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what().c_str(),
+						"Index_Intersects_resume");
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what(),
+						"Index_Intersects_resume");
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure,
+						"Unknown Error",
+						"Index_Intersects_resume");
+		return RT_Failure;
+	}
+	return RT_None;
+}
+
 SIDX_C_DLL RTError Index_SegmentIntersects_obj(  IndexH index,
 										double* pdStartPoint,
 										double* pdEndPoint,
@@ -1421,6 +1667,188 @@ SIDX_C_DLL RTError Index_NearestNeighbors_obj(IndexH index,
 	return RT_None;
 }
 
+SIDX_C_DLL RTError Index_NearestNeighborsWithin_id(IndexH index,
+											double* pdMin,
+											double* pdMax,
+											uint32_t nDimension,
+											double dMaxDistance,
+											int64_t** ids,
+											uint64_t* nResults)
+{
+	VALIDATE_POINTER1(index, "Index_NearestNeighborsWithin_id", RT_Failure);
+	Index* idx = reinterpret_cast<Index*>(index);
+  int64_t nResultLimit, nStart;
+
+  nResultLimit = idx->GetResultSetLimit();
+  nStart = idx->GetResultSetOffset();
+
+	IdVisitor* visitor = new IdVisitor;
+	MaxDistanceComparator nnc(dMaxDistance);
+
+	try {
+    SpatialIndex::Region* r = new SpatialIndex::Region(pdMin, pdMax, nDimension);
+
+		idx->index().nearestNeighborQuery(	static_cast<uint32_t>(*nResults),
+											*r,
+											*visitor,
+											nnc);
+
+		Page_ResultSet_Ids(*visitor, ids, nStart, nResultLimit, nResults);
+
+    delete r;
+		delete visitor;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what().c_str(),
+						"Index_NearestNeighborsWithin_id");
+		delete visitor;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what(),
+						"Index_NearestNeighborsWithin_id");
+		delete visitor;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure,
+						"Unknown Error",
+						"Index_NearestNeighborsWithin_id");
+		delete visitor;
+		return RT_Failure;
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_NearestNeighborsWithin_obj(IndexH index,
+											double* pdMin,
+											double* pdMax,
+											uint32_t nDimension,
+											double dMaxDistance,
+											IndexItemH** items,
+											uint64_t* nResults)
+{
+	VALIDATE_POINTER1(index, "Index_NearestNeighborsWithin_obj", RT_Failure);
+	Index* idx = reinterpret_cast<Index*>(index);
+
+  int64_t nResultLimit, nStart;
+
+  nResultLimit = idx->GetResultSetLimit();
+  nStart = idx->GetResultSetOffset();
+
+	ObjVisitor* visitor = new ObjVisitor;
+	MaxDistanceComparator nnc(dMaxDistance);
+
+	try {
+    SpatialIndex::Region* r = new SpatialIndex::Region(pdMin, pdMax, nDimension);
+
+		idx->index().nearestNeighborQuery(	static_cast<uint32_t>(*nResults),
+											*r,
+											*visitor,
+											nnc);
+
+    Page_ResultSet_Obj(*visitor, items, nStart, nResultLimit, nResults);
+
+    delete r;
+		delete visitor;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what().c_str(),
+						"Index_NearestNeighborsWithin_obj");
+		delete visitor;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what(),
+						"Index_NearestNeighborsWithin_obj");
+		delete visitor;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure,
+						"Unknown Error",
+						"Index_NearestNeighborsWithin_obj");
+		delete visitor;
+		return RT_Failure;
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_GetStatistics(	IndexH index,
+									IndexStatistics* pStats,
+									uint32_t** ppnNodesInLevel,
+									uint32_t* nLevels)
+{
+	VALIDATE_POINTER1(index, "Index_GetStatistics", RT_Failure);
+	VALIDATE_POINTER1(pStats, "Index_GetStatistics", RT_Failure);
+	Index* idx = reinterpret_cast<Index*>(index);
+
+	SpatialIndex::IStatistics* stats = 0;
+	*ppnNodesInLevel = 0;
+	*nLevels = 0;
+	memset(pStats, 0, sizeof(IndexStatistics));
+
+	try {
+		idx->index().getStatistics(&stats);
+
+		pStats->nReads = stats->getReads();
+		pStats->nWrites = stats->getWrites();
+		pStats->nNodes = stats->getNumberOfNodes();
+		pStats->nData = stats->getNumberOfData();
+		pStats->nBufferHits = idx->buffer().getHits();
+
+		SpatialIndex::ITreeStatistics* tree = dynamic_cast<SpatialIndex::ITreeStatistics*>(stats);
+		if (tree != 0)
+		{
+			pStats->nSplits = tree->getSplits();
+			pStats->nHits = tree->getHits();
+			pStats->nMisses = tree->getMisses();
+			pStats->nAdjustments = tree->getAdjustments();
+			pStats->nQueryResults = tree->getQueryResults();
+			pStats->nTreeHeight = tree->getTreeHeight();
+
+			*ppnNodesInLevel = (uint32_t*) malloc ((pStats->nTreeHeight + 1) * sizeof(uint32_t));
+			for (uint32_t l = 0; l < pStats->nTreeHeight; ++l)
+			{
+				try {
+					(*ppnNodesInLevel)[l] = tree->getNumberOfNodesInLevel(l);
+				} catch (Tools::IndexOutOfBoundsException&) {
+					break;
+				}
+				*nLevels = l + 1;
+			}
+		}
+
+		delete stats;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what().c_str(),
+						"Index_GetStatistics");
+		delete stats;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what(),
+						"Index_GetStatistics");
+		delete stats;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure,
+						"Unknown Error",
+						"Index_GetStatistics");
+		delete stats;
+		return RT_Failure;
+	}
+	return RT_None;
+}
+
 SIDX_C_DLL RTError Index_GetBounds(	  IndexH index,
 									double** ppdMin,
 									double** ppdMax,
@@ -1549,7 +1977,23 @@ SIDX_C_DLL void Index_ClearBuffer(IndexH index)
 {
 	VALIDATE_POINTER0(index, "Index_ClearBuffer");
 	Index* idx = reinterpret_cast<Index*>(index);
-	idx->buffer().clear();
+	try {
+		idx->buffer().clear();
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what().c_str(),
+						"Index_ClearBuffer");
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure,
+						e.what(),
+						"Index_ClearBuffer");
+	} catch (...) {
+		Error_PushError(RT_Failure,
+						"Unknown Error",
+						"Index_ClearBuffer");
+	}
 }
 
 SIDX_C_DLL void Index_DestroyObjResults(IndexItemH* results, uint32_t nResults)
@@ -1748,6 +2192,18 @@ SIDX_C_DLL RTError IndexItem_GetBounds(	  IndexItemH item,
 	delete s;
 	return RT_None;
 }
+SIDX_C_DLL IndexPositionH IndexPosition_Create()
+{
+	return (IndexPositionH) new SpatialIndex::RTree::QueryPosition();
+}
+
+SIDX_C_DLL void IndexPosition_Destroy(IndexPositionH hPosition)
+{
+	VALIDATE_POINTER0(hPosition, "IndexPosition_Destroy");
+	SpatialIndex::RTree::QueryPosition* position = reinterpret_cast<SpatialIndex::RTree::QueryPosition*>(hPosition);
+	delete position;
+}
+
 SIDX_C_DLL IndexPropertyH IndexProperty_Create()
 {
 	Tools::PropertySet* ps = GetDefaults();
@@ -220,7 +220,7 @@ SpatialIndex::MVRTree::MVRTree::MVRTree(IStorageManager& sm, Tools::PropertySet&
 	m_leafPool(100)
 {
 #ifdef HAVE_PTHREAD_H
-	pthread_mutex_init(&m_lock, NULL);
+	Tools::initSharedLock(&m_rwLock);
 #endif
 
 	Tools::Variant var = ps.getProperty("IndexIdentifier");
@@ -245,7 +245,7 @@ SpatialIndex::MVRTree::MVRTree::MVRTree(IStorageManager& sm, Tools::PropertySet&
 SpatialIndex::MVRTree::MVRTree::~MVRTree()
 {
 #ifdef HAVE_PTHREAD_H
-	pthread_mutex_destroy(&m_lock);
+	pthread_rwlock_destroy(&m_rwLock);
 #endif
 
 	storeHeader();
@@ -263,7 +263,7 @@ void SpatialIndex::MVRTree::MVRTree::insertData(uint32_t len, const byte* pData,
 	if (ti->getLowerBound() < m_currentTime) throw Tools::IllegalArgumentException("insertData: Shape start time is older than tree current time.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::ExclusiveLockGuard lock(&m_rwLock);
 #endif
 
 	// convert the shape into a TimeRegion (R-Trees index regions only; i.e., approximations of the shapes).
@@ -297,7 +297,7 @@ bool SpatialIndex::MVRTree::MVRTree::deleteData(const IShape& shape, id_type id)
 	if (ti == 0) throw Tools::IllegalArgumentException("deleteData: Shape does not support the Tools::IInterval interface.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::ExclusiveLockGuard lock(&m_rwLock);
 #endif
 
 	Region mbrold;
@@ -357,7 +357,7 @@ void SpatialIndex::MVRTree::MVRTree::selfJoinQuery(const IShape&, IVisitor&)
 void SpatialIndex::MVRTree::MVRTree::queryStrategy(IQueryStrategy& qs)
 {
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::SharedLockGuard lock(&m_rwLock);
 #endif
 
 	id_type next = m_roots[m_roots.size() - 1].m_id;
@@ -1201,7 +1201,7 @@ SpatialIndex::MVRTree::NodePtr SpatialIndex::MVRTree::MVRTree::readNode(id_type
 		n->m_identifier = id;
 		n->loadFromByteArray(buffer);
 
-		++(m_stats.m_u64Reads);
+		Tools::atomicAdd(m_stats.m_u64Reads, 1);
 
 		for (size_t cIndex = 0; cIndex < m_readNodeCommands.size(); ++cIndex)
 		{
@@ -1248,9 +1248,11 @@ void SpatialIndex::MVRTree::MVRTree::rangeQuery(RangeQueryType type, const IShap
 	if (ti == 0) throw Tools::IllegalArgumentException("rangeQuery: Shape does not support the Tools::IInterval interface.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::SharedLockGuard lock(&m_rwLock);
 #endif
 
+	IBoundedVisitor* pBounded = dynamic_cast<IBoundedVisitor*>(&v);
+
 	std::set<id_type> visitedNodes;
 	std::set<id_type> visitedData;
 	std::stack<NodePtr> st;
@@ -1285,7 +1287,8 @@ void SpatialIndex::MVRTree::MVRTree::rangeQuery(RangeQueryType type, const IShap
 					visitedData.insert(n->m_pIdentifier[cChild]);
 					Data data = Data(n->m_pDataLength[cChild], n->m_pData[cChild], *(n->m_ptrMBR[cChild]), n->m_pIdentifier[cChild]);
 					v.visitData(data);
-					++(m_stats.m_u64QueryResults);
+					Tools::atomicAdd(m_stats.m_u64QueryResults, 1);
+					if (pBounded != 0 && pBounded->isDone()) return;
 				}
 			}
 		}
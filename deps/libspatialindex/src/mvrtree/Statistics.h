@@ -36,7 +36,7 @@ namespace SpatialIndex
 		class Leaf;
 		class Index;
 
-		class Statistics : public SpatialIndex::IStatistics
+		class Statistics : public SpatialIndex::ITreeStatistics
 		{
 		public:
 			Statistics();
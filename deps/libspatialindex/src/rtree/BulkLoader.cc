@@ -332,8 +332,7 @@ void BulkLoader::bulkLoadUsingSTR(
 			"RTree::BulkLoader::bulkLoadUsingSTR: Empty data stream given."
 		);
 
-	NodePtr n = pTree->readNode(pTree->m_rootID);
-	pTree->deleteNode(n.get());
+	pTree->deleteNode(pTree->readNode(pTree->m_rootID).get());
 
 	#ifndef NDEBUG
 	std::cerr << "RTree::BulkLoader: Sorting data." << std::endl;
@@ -378,6 +377,7 @@ void BulkLoader::bulkLoadUsingSTR(
 
 	pTree->m_stats.m_u32TreeHeight = level;
 	pTree->storeHeader();
+	pTree->releaseRetiredNodes();
 }
 
 void BulkLoader::createLevel(
@@ -413,7 +413,7 @@ void BulkLoader::createLevel(
 				es2->insert(new ExternalSorter::Record(n->m_nodeMBR, n->m_identifier, 0, 0, 0));
 				pTree->m_rootID = n->m_identifier;
 					// special case when the root has exactly bindex entries.
-				delete n;
+				if (! pTree->m_bResidentNodes) delete n;
 			}
 		}
 
@@ -423,7 +423,7 @@ void BulkLoader::createLevel(
 			pTree->writeNode(n);
 			es2->insert(new ExternalSorter::Record(n->m_nodeMBR, n->m_identifier, 0, 0, 0));
 			pTree->m_rootID = n->m_identifier;
-			delete n;
+			if (! pTree->m_bResidentNodes) delete n;
 		}
 	}
 	else
@@ -148,14 +148,16 @@ uint32_t Index::findLeastEnlargement(const Region& r) const
 	double area = std::numeric_limits<double>::max();
 	uint32_t best = std::numeric_limits<uint32_t>::max();
 
-	RegionPtr t = m_pTree->m_regionPool.acquire();
+	if (m_children == 0) return best;
+
+	std::vector<double> areas(m_children), combined(m_children);
+	getChildAreas(&(areas[0]), m_children);
+	getChildCombinedAreas(r.m_pLow, r.m_pHigh, &(combined[0]), m_children);
 
 	for (uint32_t cChild = 0; cChild < m_children; ++cChild)
 	{
-		m_ptrMBR[cChild]->getCombinedRegion(*t, r);
-
-		double a = m_ptrMBR[cChild]->getArea();
-		double enl = t->getArea() - a;
+		double a = areas[cChild];
+		double enl = combined[cChild] - a;
 
 		if (enl < area)
 		{
@@ -164,9 +166,7 @@ uint32_t Index::findLeastEnlargement(const Region& r) const
 		}
 		else if (enl == area)
 		{
-			// this will rarely happen, so compute best area on the fly only
-			// when necessary.
-			if (a < m_ptrMBR[best]->getArea()) best = cChild;
+			if (a < areas[best]) best = cChild;
 		}
 	}
 
@@ -181,6 +181,10 @@ uint32_t Index::findLeastOverlap(const Region& r) const
 	double me = std::numeric_limits<double>::max();
 	OverlapEntry* best = 0;
 
+	std::vector<double> areas(m_children), combined(m_children), overlap(m_children), original(m_children);
+	getChildAreas(&(areas[0]), m_children);
+	getChildCombinedAreas(r.m_pLow, r.m_pHigh, &(combined[0]), m_children);
+
 	// find combined region and enlargement of every entry and store it.
 	for (uint32_t cChild = 0; cChild < m_children; ++cChild)
 	{
@@ -199,8 +203,8 @@ uint32_t Index::findLeastOverlap(const Region& r) const
 		entries[cChild]->m_original = m_ptrMBR[cChild];
 		entries[cChild]->m_combined = m_pTree->m_regionPool.acquire();
 		m_ptrMBR[cChild]->getCombinedRegion(*(entries[cChild]->m_combined), r);
-		entries[cChild]->m_oa = entries[cChild]->m_original->getArea();
-		entries[cChild]->m_ca = entries[cChild]->m_combined->getArea();
+		entries[cChild]->m_oa = areas[cChild];
+		entries[cChild]->m_ca = combined[cChild];
 		entries[cChild]->m_enlargement = entries[cChild]->m_ca - entries[cChild]->m_oa;
 
 		if (entries[cChild]->m_enlargement < me)
@@ -239,12 +243,15 @@ uint32_t Index::findLeastOverlap(const Region& r) const
 			double dif = 0.0;
 			OverlapEntry* e = entries[cIndex];
 
+			getChildIntersectingAreas(e->m_combined->m_pLow, e->m_combined->m_pHigh, &(overlap[0]), m_children);
+			getChildIntersectingAreas(e->m_original->m_pLow, e->m_original->m_pHigh, &(original[0]), m_children);
+
 			for (uint32_t cChild = 0; cChild < m_children; ++cChild)
 			{
 				if (e->m_index != cChild)
 				{
-					double f = e->m_combined->getIntersectingArea(*(m_ptrMBR[cChild]));
-					if (f != 0.0) dif += f - e->m_original->getIntersectingArea(*(m_ptrMBR[cChild]));
+					double f = overlap[cChild];
+					if (f != 0.0) dif += f - original[cChild];
 				}
 			} // for (cChild)
 
@@ -258,7 +265,7 @@ uint32_t Index::findLeastOverlap(const Region& r) const
 				if (e->m_enlargement == best->m_enlargement)
 				{
 					// keep the one with least area.
-					if (e->m_original->getArea() < best->m_original->getArea()) best = entries[cIndex];
+					if (e->m_oa < best->m_oa) best = entries[cIndex];
 				}
 				else
 				{
@@ -299,6 +306,7 @@ void Index::adjustTree(Node* n, std::stack<id_type>& pathBuffer, bool force)
 	bool bRecompute = (! bContained || (bTouches && m_pTree->m_bTightMBRs));
 
 	*(m_ptrMBR[child]) = n->m_nodeMBR;
+	setChildMBR(child);
 
 	if (bRecompute || force)
 	{
@@ -347,6 +355,7 @@ void Index::adjustTree(Node* n1, Node* n2, std::stack<id_type>& pathBuffer, byte
 	bool bRecompute = (! bContained || (bTouches && m_pTree->m_bTightMBRs));
 
 	*(m_ptrMBR[child]) = n1->m_nodeMBR;
+	setChildMBR(child);
 
 	if (bRecompute)
 	{
@@ -29,6 +29,11 @@
 #include <cmath>
 #include <limits>
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIDX_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
 #include <spatialindex/SpatialIndex.h>
 
 #include "RTree.h"
@@ -38,6 +43,289 @@
 using namespace SpatialIndex;
 using namespace SpatialIndex::RTree;
 
+//
+// Child scan kernels
+//
+// They read the by-dimension child MBRs of a node (see Node::m_pChildLow) and test or
+// measure a query box against all the children at once. Each is a template over the
+// dimension, instantiated for 2 and 3 so that the loops over dimensions are unrolled,
+// and for 0, which takes the dimension at run time. Hits and distances also have SSE2
+// and AVX2 versions for x86-64. All of them give exactly the results of the Region
+// methods, down to NaN coordinates: a comparison with NaN never rules a child out and
+// never adds to its distance, so the vector compares are the unordered negations.
+
+template <uint32_t D>
+static inline bool childHit(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t cChild, const double* pLow, const double* pHigh, bool bContainment)
+{
+	const uint32_t dims = (D != 0) ? D : dimension;
+
+	for (uint32_t cDim = 0; cDim < dims; ++cDim)
+	{
+		double l = pChildLow[cDim * stride + cChild];
+		double h = pChildHigh[cDim * stride + cChild];
+
+		if (bContainment)
+		{
+			if (l < pLow[cDim] || h > pHigh[cDim]) return false;
+		}
+		else
+		{
+			if (l > pHigh[cDim] || h < pLow[cDim]) return false;
+		}
+	}
+	return true;
+}
+
+template <uint32_t D>
+static inline double childDistance(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t cChild, const double* pLow, const double* pHigh)
+{
+	const uint32_t dims = (D != 0) ? D : dimension;
+	double ret = 0.0;
+
+	for (uint32_t cDim = 0; cDim < dims; ++cDim)
+	{
+		double x = std::max(0.0, pChildLow[cDim * stride + cChild] - pHigh[cDim]) + std::max(0.0, pLow[cDim] - pChildHigh[cDim * stride + cChild]);
+		ret += x * x;
+	}
+	return std::sqrt(ret);
+}
+
+template <uint32_t D>
+static void getChildHitsPortable(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, const double* pLow, const double* pHigh, bool bContainment, uint64_t* hits)
+{
+	for (uint32_t cChild = 0; cChild < children; ++cChild)
+	{
+		if (childHit<D>(pChildLow, pChildHigh, stride, dimension, cChild, pLow, pHigh, bContainment))
+			hits[cChild >> 6] |= static_cast<uint64_t>(1) << (cChild & 63);
+	}
+}
+
+template <uint32_t D>
+static void getChildDistancesPortable(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, const double* pLow, const double* pHigh, double* distances)
+{
+	for (uint32_t cChild = 0; cChild < children; ++cChild)
+		distances[cChild] = childDistance<D>(pChildLow, pChildHigh, stride, dimension, cChild, pLow, pHigh);
+}
+
+template <uint32_t D>
+static void getChildAreas(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, double* areas)
+{
+	const uint32_t dims = (D != 0) ? D : dimension;
+	uint32_t cChild;
+
+	for (cChild = 0; cChild < children; ++cChild) areas[cChild] = 1.0;
+
+	for (uint32_t cDim = 0; cDim < dims; ++cDim)
+	{
+		const double* pL = pChildLow + cDim * stride;
+		const double* pH = pChildHigh + cDim * stride;
+
+		for (cChild = 0; cChild < children; ++cChild)
+			areas[cChild] *= pH[cChild] - pL[cChild];
+	}
+}
+
+template <uint32_t D>
+static void getChildCombinedAreas(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, const double* pLow, const double* pHigh, double* areas)
+{
+	const uint32_t dims = (D != 0) ? D : dimension;
+	uint32_t cChild;
+
+	for (cChild = 0; cChild < children; ++cChild) areas[cChild] = 1.0;
+
+	for (uint32_t cDim = 0; cDim < dims; ++cDim)
+	{
+		const double* pL = pChildLow + cDim * stride;
+		const double* pH = pChildHigh + cDim * stride;
+		double l = pLow[cDim];
+		double h = pHigh[cDim];
+
+		for (cChild = 0; cChild < children; ++cChild)
+			areas[cChild] *= std::max(pH[cChild], h) - std::min(pL[cChild], l);
+	}
+}
+
+template <uint32_t D>
+static void getChildIntersectingAreas(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, const double* pLow, const double* pHigh, double* areas)
+{
+	const uint32_t dims = (D != 0) ? D : dimension;
+	uint32_t cChild;
+
+	for (cChild = 0; cChild < children; ++cChild) areas[cChild] = 1.0;
+
+	for (uint32_t cDim = 0; cDim < dims; ++cDim)
+	{
+		const double* pL = pChildLow + cDim * stride;
+		const double* pH = pChildHigh + cDim * stride;
+		double l = pLow[cDim];
+		double h = pHigh[cDim];
+
+		for (cChild = 0; cChild < children; ++cChild)
+			areas[cChild] *= std::max(std::min(pH[cChild], h) - std::max(pL[cChild], l), 0.0);
+	}
+}
+
+#ifdef SIDX_X86_KERNELS
+template <uint32_t D>
+static void getChildHitsSSE2(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, const double* pLow, const double* pHigh, bool bContainment, uint64_t* hits)
+{
+	const uint32_t dims = (D != 0) ? D : dimension;
+	uint32_t cChild = 0;
+
+	for (; cChild + 2 <= children; cChild += 2)
+	{
+		int bits = 0x3;
+
+		for (uint32_t cDim = 0; cDim < dims && bits != 0; ++cDim)
+		{
+			__m128d l = _mm_loadu_pd(pChildLow + cDim * stride + cChild);
+			__m128d h = _mm_loadu_pd(pChildHigh + cDim * stride + cChild);
+			__m128d in;
+
+			if (bContainment) in = _mm_and_pd(_mm_cmpnlt_pd(l, _mm_set1_pd(pLow[cDim])), _mm_cmpngt_pd(h, _mm_set1_pd(pHigh[cDim])));
+			else in = _mm_and_pd(_mm_cmpngt_pd(l, _mm_set1_pd(pHigh[cDim])), _mm_cmpnlt_pd(h, _mm_set1_pd(pLow[cDim])));
+
+			bits &= _mm_movemask_pd(in);
+		}
+
+		hits[cChild >> 6] |= static_cast<uint64_t>(bits) << (cChild & 63);
+	}
+
+	for (; cChild < children; ++cChild)
+	{
+		if (childHit<D>(pChildLow, pChildHigh, stride, dimension, cChild, pLow, pHigh, bContainment))
+			hits[cChild >> 6] |= static_cast<uint64_t>(1) << (cChild & 63);
+	}
+}
+
+template <uint32_t D>
+static void getChildDistancesSSE2(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, const double* pLow, const double* pHigh, double* distances)
+{
+	const uint32_t dims = (D != 0) ? D : dimension;
+	const __m128d zero = _mm_setzero_pd();
+	uint32_t cChild = 0;
+
+	for (; cChild + 2 <= children; cChild += 2)
+	{
+		__m128d sum = zero;
+
+		for (uint32_t cDim = 0; cDim < dims; ++cDim)
+		{
+			__m128d l = _mm_loadu_pd(pChildLow + cDim * stride + cChild);
+			__m128d h = _mm_loadu_pd(pChildHigh + cDim * stride + cChild);
+			__m128d x = _mm_add_pd(
+				_mm_max_pd(_mm_sub_pd(l, _mm_set1_pd(pHigh[cDim])), zero),
+				_mm_max_pd(_mm_sub_pd(_mm_set1_pd(pLow[cDim]), h), zero));
+			sum = _mm_add_pd(sum, _mm_mul_pd(x, x));
+		}
+
+		_mm_storeu_pd(distances + cChild, _mm_sqrt_pd(sum));
+	}
+
+	for (; cChild < children; ++cChild)
+		distances[cChild] = childDistance<D>(pChildLow, pChildHigh, stride, dimension, cChild, pLow, pHigh);
+}
+
+template <uint32_t D>
+__attribute__((target("avx2")))
+static void getChildHitsAVX2(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, const double* pLow, const double* pHigh, bool bContainment, uint64_t* hits)
+{
+	const uint32_t dims = (D != 0) ? D : dimension;
+	uint32_t cChild = 0;
+
+	for (; cChild + 4 <= children; cChild += 4)
+	{
+		int bits = 0xf;
+
+		for (uint32_t cDim = 0; cDim < dims && bits != 0; ++cDim)
+		{
+			__m256d l = _mm256_loadu_pd(pChildLow + cDim * stride + cChild);
+			__m256d h = _mm256_loadu_pd(pChildHigh + cDim * stride + cChild);
+			__m256d in;
+
+			if (bContainment) in = _mm256_and_pd(_mm256_cmp_pd(l, _mm256_set1_pd(pLow[cDim]), _CMP_NLT_UQ), _mm256_cmp_pd(h, _mm256_set1_pd(pHigh[cDim]), _CMP_NGT_UQ));
+			else in = _mm256_and_pd(_mm256_cmp_pd(l, _mm256_set1_pd(pHigh[cDim]), _CMP_NGT_UQ), _mm256_cmp_pd(h, _mm256_set1_pd(pLow[cDim]), _CMP_NLT_UQ));
+
+			bits &= _mm256_movemask_pd(in);
+		}
+
+		hits[cChild >> 6] |= static_cast<uint64_t>(bits) << (cChild & 63);
+	}
+
+	for (; cChild < children; ++cChild)
+	{
+		if (childHit<D>(pChildLow, pChildHigh, stride, dimension, cChild, pLow, pHigh, bContainment))
+			hits[cChild >> 6] |= static_cast<uint64_t>(1) << (cChild & 63);
+	}
+}
+
+template <uint32_t D>
+__attribute__((target("avx2")))
+static void getChildDistancesAVX2(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, const double* pLow, const double* pHigh, double* distances)
+{
+	const uint32_t dims = (D != 0) ? D : dimension;
+	const __m256d zero = _mm256_setzero_pd();
+	uint32_t cChild = 0;
+
+	for (; cChild + 4 <= children; cChild += 4)
+	{
+		__m256d sum = zero;
+
+		for (uint32_t cDim = 0; cDim < dims; ++cDim)
+		{
+			__m256d l = _mm256_loadu_pd(pChildLow + cDim * stride + cChild);
+			__m256d h = _mm256_loadu_pd(pChildHigh + cDim * stride + cChild);
+			__m256d x = _mm256_add_pd(
+				_mm256_max_pd(_mm256_sub_pd(l, _mm256_set1_pd(pHigh[cDim])), zero),
+				_mm256_max_pd(_mm256_sub_pd(_mm256_set1_pd(pLow[cDim]), h), zero));
+			sum = _mm256_add_pd(sum, _mm256_mul_pd(x, x));
+		}
+
+		_mm256_storeu_pd(distances + cChild, _mm256_sqrt_pd(sum));
+	}
+
+	for (; cChild < children; ++cChild)
+		distances[cChild] = childDistance<D>(pChildLow, pChildHigh, stride, dimension, cChild, pLow, pHigh);
+}
+#endif
+
+template <uint32_t D>
+static ChildKernels selectChildKernels()
+{
+	ChildKernels k;
+	k.m_getHits = getChildHitsPortable<D>;
+	k.m_getAreas = getChildAreas<D>;
+	k.m_getCombinedAreas = getChildCombinedAreas<D>;
+	k.m_getIntersectingAreas = getChildIntersectingAreas<D>;
+	k.m_getMinimumDistances = getChildDistancesPortable<D>;
+
+#ifdef SIDX_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		k.m_getHits = getChildHitsAVX2<D>;
+		k.m_getMinimumDistances = getChildDistancesAVX2<D>;
+	}
+	else if (__builtin_cpu_supports("sse2"))
+	{
+		k.m_getHits = getChildHitsSSE2<D>;
+		k.m_getMinimumDistances = getChildDistancesSSE2<D>;
+	}
+#endif
+
+	return k;
+}
+
+ChildKernels ChildKernels::select(uint32_t dimension)
+{
+	switch (dimension)
+	{
+		case 2: return selectChildKernels<2>();
+		case 3: return selectChildKernels<3>();
+		default: return selectChildKernels<0>();
+	}
+}
+
 //
 // Tools::IObject interface
 //
@@ -82,6 +370,7 @@ void Node::loadFromByteArray(const byte* ptr)
 		ptr += m_pTree->m_dimension * sizeof(double);
 		memcpy(m_ptrMBR[u32Child]->m_pHigh, ptr, m_pTree->m_dimension * sizeof(double));
 		ptr += m_pTree->m_dimension * sizeof(double);
+		setChildMBR(u32Child);
 		memcpy(&(m_pIdentifier[u32Child]), ptr, sizeof(id_type));
 		ptr += sizeof(id_type);
 
@@ -235,9 +524,12 @@ Node::Node() :
 	m_capacity(0),
 	m_pData(0),
 	m_ptrMBR(0),
+	m_pChildLow(0),
+	m_pChildHigh(0),
 	m_pIdentifier(0),
 	m_pDataLength(0),
-	m_totalDataLength(0)
+	m_totalDataLength(0),
+	m_bResident(false)
 {
 }
 
@@ -249,9 +541,12 @@ Node::Node(SpatialIndex::RTree::RTree* pTree, id_type id, uint32_t level, uint32
 	m_capacity(capacity),
 	m_pData(0),
 	m_ptrMBR(0),
+	m_pChildLow(0),
+	m_pChildHigh(0),
 	m_pIdentifier(0),
 	m_pDataLength(0),
-	m_totalDataLength(0)
+	m_totalDataLength(0),
+	m_bResident(false)
 {
 	m_nodeMBR.makeInfinite(m_pTree->m_dimension);
 
@@ -260,6 +555,8 @@ Node::Node(SpatialIndex::RTree::RTree* pTree, id_type id, uint32_t level, uint32
 		m_pDataLength = new uint32_t[m_capacity + 1];
 		m_pData = new byte*[m_capacity + 1];
 		m_ptrMBR = new RegionPtr[m_capacity + 1];
+		m_pChildLow = new double[m_pTree->m_dimension * (m_capacity + 1)];
+		m_pChildHigh = new double[m_pTree->m_dimension * (m_capacity + 1)];
 		m_pIdentifier = new id_type[m_capacity + 1];
 	}
 	catch (...)
@@ -267,6 +564,8 @@ Node::Node(SpatialIndex::RTree::RTree* pTree, id_type id, uint32_t level, uint32
 		delete[] m_pDataLength;
 		delete[] m_pData;
 		delete[] m_ptrMBR;
+		delete[] m_pChildLow;
+		delete[] m_pChildHigh;
 		delete[] m_pIdentifier;
 		throw;
 	}
@@ -286,6 +585,8 @@ Node::~Node()
 
 	delete[] m_pDataLength;
 	delete[] m_ptrMBR;
+	delete[] m_pChildLow;
+	delete[] m_pChildHigh;
 	delete[] m_pIdentifier;
 }
 
@@ -302,6 +603,7 @@ void Node::insertEntry(uint32_t dataLength, byte* pData, Region& mbr, id_type id
 	m_pData[m_children] = pData;
 	m_ptrMBR[m_children] = m_pTree->m_regionPool.acquire();
 	*(m_ptrMBR[m_children]) = mbr;
+	setChildMBR(m_children);
 	m_pIdentifier[m_children] = id;
 
 	m_totalDataLength += dataLength;
@@ -325,6 +627,7 @@ void Node::deleteEntry(uint32_t index)
 		m_pDataLength[index] = m_pDataLength[m_children - 1];
 		m_pData[index] = m_pData[m_children - 1];
 		m_ptrMBR[index] = m_ptrMBR[m_children - 1];
+		setChildMBR(index);
 		m_pIdentifier[index] = m_pIdentifier[m_children - 1];
 	}
 
@@ -449,7 +752,11 @@ bool Node::insertData(uint32_t dataLength, byte* pData, Region& mbr, id_type id,
 		m_children = lKeep;
 		m_totalDataLength = 0;
 
-		for (uint32_t u32Child = 0; u32Child < m_children; ++u32Child) m_totalDataLength += m_pDataLength[u32Child];
+		for (uint32_t u32Child = 0; u32Child < m_children; ++u32Child)
+		{
+			m_totalDataLength += m_pDataLength[u32Child];
+			setChildMBR(u32Child);
+		}
 
 		for (uint32_t cDim = 0; cDim < m_nodeMBR.m_dimension; ++cDim)
 		{
@@ -553,6 +860,7 @@ void Node::reinsertData(uint32_t dataLength, byte* pData, Region& mbr, id_type i
 	m_pData[m_children] = pData;
 	m_ptrMBR[m_children] = m_pTree->m_regionPool.acquire();
 	*(m_ptrMBR[m_children]) = mbr;
+	setChildMBR(m_children);
 	m_pIdentifier[m_children] = id;
 
 	PointPtr nc = m_pTree->m_pointPool.acquire();
@@ -624,6 +932,7 @@ void Node::rtreeSplit(uint32_t dataLength, byte* pData, Region& mbr, id_type id,
 	m_pData[m_capacity] = pData;
 	m_ptrMBR[m_capacity] = m_pTree->m_regionPool.acquire();
 	*(m_ptrMBR[m_capacity]) = mbr;
+	setChildMBR(m_capacity);
 	m_pIdentifier[m_capacity] = id;
 	// m_totalDataLength does not need to be increased here.
 
@@ -783,6 +1092,7 @@ void Node::rstarSplit(uint32_t dataLength, byte* pData, Region& mbr, id_type id,
 	m_pData[m_capacity] = pData;
 	m_ptrMBR[m_capacity] = m_pTree->m_regionPool.acquire();
 	*(m_ptrMBR[m_capacity]) = mbr;
+	setChildMBR(m_capacity);
 	m_pIdentifier[m_capacity] = id;
 	// m_totalDataLength does not need to be increased here.
 
@@ -942,6 +1252,7 @@ void Node::pickSeeds(uint32_t& index1, uint32_t& index2)
 	double separation = -std::numeric_limits<double>::max();
 	double inefficiency = -std::numeric_limits<double>::max();
 	uint32_t cDim, u32Child, cIndex;
+	uint32_t stride = m_capacity + 1;
 
 	switch (m_pTree->m_treeVariant)
 	{
@@ -949,25 +1260,27 @@ void Node::pickSeeds(uint32_t& index1, uint32_t& index2)
 		case RV_RSTAR:
 			for (cDim = 0; cDim < m_pTree->m_dimension; ++cDim)
 			{
-				double leastLower = m_ptrMBR[0]->m_pLow[cDim];
-				double greatestUpper = m_ptrMBR[0]->m_pHigh[cDim];
+				const double* pLow = m_pChildLow + cDim * stride;
+				const double* pHigh = m_pChildHigh + cDim * stride;
+				double leastLower = pLow[0];
+				double greatestUpper = pHigh[0];
 				uint32_t greatestLower = 0;
 				uint32_t leastUpper = 0;
 				double width;
 
 				for (u32Child = 1; u32Child <= m_capacity; ++u32Child)
 				{
-					if (m_ptrMBR[u32Child]->m_pLow[cDim] > m_ptrMBR[greatestLower]->m_pLow[cDim]) greatestLower = u32Child;
-					if (m_ptrMBR[u32Child]->m_pHigh[cDim] < m_ptrMBR[leastUpper]->m_pHigh[cDim]) leastUpper = u32Child;
+					if (pLow[u32Child] > pLow[greatestLower]) greatestLower = u32Child;
+					if (pHigh[u32Child] < pHigh[leastUpper]) leastUpper = u32Child;
 
-					leastLower = std::min(m_ptrMBR[u32Child]->m_pLow[cDim], leastLower);
-					greatestUpper = std::max(m_ptrMBR[u32Child]->m_pHigh[cDim], greatestUpper);
+					leastLower = std::min(pLow[u32Child], leastLower);
+					greatestUpper = std::max(pHigh[u32Child], greatestUpper);
 				}
 
 				width = greatestUpper - leastLower;
 				if (width <= 0) width = 1;
 
-				double f = (m_ptrMBR[greatestLower]->m_pLow[cDim] - m_ptrMBR[leastUpper]->m_pHigh[cDim]) / width;
+				double f = (pLow[greatestLower] - pHigh[leastUpper]) / width;
 
 				if (f > separation)
 				{
@@ -985,19 +1298,20 @@ void Node::pickSeeds(uint32_t& index1, uint32_t& index2)
 
 			break;
 		case RV_QUADRATIC:
+		{
+			std::vector<double> area(stride), combined(stride);
+			getChildAreas(&(area[0]), stride);
+
 			// for each pair of Regions (account for overflow Region too!)
 			for (u32Child = 0; u32Child < m_capacity; ++u32Child)
 			{
-				double a = m_ptrMBR[u32Child]->getArea();
+				// the combined MBRs of this entry with every other one.
+				getChildCombinedAreas(m_ptrMBR[u32Child]->m_pLow, m_ptrMBR[u32Child]->m_pHigh, &(combined[0]), stride);
 
 				for (cIndex = u32Child + 1; cIndex <= m_capacity; ++cIndex)
 				{
-					// get the combined MBR of those two entries.
-					Region r;
-					m_ptrMBR[u32Child]->getCombinedRegion(r, *(m_ptrMBR[cIndex]));
-
 					// find the inefficiency of grouping these entries together.
-					double d = r.getArea() - a - m_ptrMBR[cIndex]->getArea();
+					double d = combined[cIndex] - area[u32Child] - area[cIndex];
 
 					if (d > inefficiency)
 					{
@@ -1009,11 +1323,52 @@ void Node::pickSeeds(uint32_t& index1, uint32_t& index2)
 			} // for (u32Child)
 
 			break;
+		}
 		default:
 			throw Tools::NotSupportedException("Node::pickSeeds: Tree variant not supported.");
 	}
 }
 
+void Node::setChildMBR(uint32_t index)
+{
+	uint32_t stride = m_capacity + 1;
+
+	for (uint32_t cDim = 0; cDim < m_pTree->m_dimension; ++cDim)
+	{
+		m_pChildLow[cDim * stride + index] = m_ptrMBR[index]->m_pLow[cDim];
+		m_pChildHigh[cDim * stride + index] = m_ptrMBR[index]->m_pHigh[cDim];
+	}
+}
+
+// The scans below go through the tree's child kernels, see the top of this file.
+
+void Node::getChildHits(const double* pLow, const double* pHigh, bool bContainment, uint64_t* hits) const
+{
+	for (uint32_t cWord = 0; cWord < (m_children + 63) / 64; ++cWord) hits[cWord] = 0;
+
+	m_pTree->m_kernels.m_getHits(m_pChildLow, m_pChildHigh, m_capacity + 1, m_pTree->m_dimension, m_children, pLow, pHigh, bContainment, hits);
+}
+
+void Node::getChildAreas(double* areas, uint32_t count) const
+{
+	m_pTree->m_kernels.m_getAreas(m_pChildLow, m_pChildHigh, m_capacity + 1, m_pTree->m_dimension, count, areas);
+}
+
+void Node::getChildCombinedAreas(const double* pLow, const double* pHigh, double* areas, uint32_t count) const
+{
+	m_pTree->m_kernels.m_getCombinedAreas(m_pChildLow, m_pChildHigh, m_capacity + 1, m_pTree->m_dimension, count, pLow, pHigh, areas);
+}
+
+void Node::getChildIntersectingAreas(const double* pLow, const double* pHigh, double* areas, uint32_t count) const
+{
+	m_pTree->m_kernels.m_getIntersectingAreas(m_pChildLow, m_pChildHigh, m_capacity + 1, m_pTree->m_dimension, count, pLow, pHigh, areas);
+}
+
+void Node::getChildMinimumDistances(const double* pLow, const double* pHigh, double* distances) const
+{
+	m_pTree->m_kernels.m_getMinimumDistances(m_pChildLow, m_pChildHigh, m_capacity + 1, m_pTree->m_dimension, m_children, pLow, pHigh, distances);
+}
+
 void Node::condenseTree(std::stack<NodePtr>& toReinsert, std::stack<id_type>& pathBuffer, NodePtr& ptrThis)
 {
 	uint32_t minimumLoad = static_cast<uint32_t>(std::floor(m_capacity * m_pTree->m_fillFactor));
@@ -1081,6 +1436,7 @@ void Node::condenseTree(std::stack<NodePtr>& toReinsert, std::stack<id_type>& pa
 		{
 			// adjust the entry in 'p' to contain the new bounding region of this node.
 			*(p->m_ptrMBR[child]) = m_nodeMBR;
+			p->setChildMBR(child);
 
 			// global recalculation necessary since the MBR can only shrink in size,
 			// due to data removal.
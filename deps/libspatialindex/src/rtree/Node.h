@@ -38,6 +38,24 @@ namespace SpatialIndex
 
 		typedef Tools::PoolPointer<Node> NodePtr;
 
+		class ChildKernels
+		{
+		public:
+			static ChildKernels select(uint32_t dimension);
+				// The kernels for trees of the given dimension, specialised for two and three
+				// dimensions and for what the CPU supports.
+
+			typedef void (*HitsKernel)(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, const double* pLow, const double* pHigh, bool bContainment, uint64_t* hits);
+			typedef void (*AreasKernel)(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, double* areas);
+			typedef void (*MeasureKernel)(const double* pChildLow, const double* pChildHigh, uint32_t stride, uint32_t dimension, uint32_t children, const double* pLow, const double* pHigh, double* out);
+
+			HitsKernel m_getHits;
+			AreasKernel m_getAreas;
+			MeasureKernel m_getCombinedAreas;
+			MeasureKernel m_getIntersectingAreas;
+			MeasureKernel m_getMinimumDistances;
+		}; // ChildKernels
+
 		class Node : public SpatialIndex::INode
 		{
 		public:
@@ -89,6 +107,14 @@ namespace SpatialIndex
 
 			virtual void pickSeeds(uint32_t& index1, uint32_t& index2);
 
+			void setChildMBR(uint32_t index);
+			void getChildHits(const double* pLow, const double* pHigh, bool bContainment, uint64_t* hits) const;
+				// Sets bit i of hits when the query box intersects, or contains, child i.
+			void getChildAreas(double* areas, uint32_t count) const;
+			void getChildCombinedAreas(const double* pLow, const double* pHigh, double* areas, uint32_t count) const;
+			void getChildIntersectingAreas(const double* pLow, const double* pHigh, double* areas, uint32_t count) const;
+			void getChildMinimumDistances(const double* pLow, const double* pHigh, double* distances) const;
+
 			virtual void condenseTree(std::stack<NodePtr>& toReinsert, std::stack<id_type>& pathBuffer, NodePtr& ptrThis);
 
 			virtual NodePtr chooseSubtree(const Region& mbr, uint32_t level, std::stack<id_type>& pathBuffer) = 0;
@@ -121,6 +147,12 @@ namespace SpatialIndex
 			RegionPtr* m_ptrMBR;
 				// The corresponding data MBRs.
 
+			double* m_pChildLow;
+			double* m_pChildHigh;
+				// The same MBRs laid out by dimension, so that scans over the children read
+				// contiguous memory. The low of child i in dimension d is
+				// m_pChildLow[d * (m_capacity + 1) + i]. setChildMBR keeps them in step with m_ptrMBR.
+
 			id_type* m_pIdentifier;
 				// The corresponding data identifiers.
 
@@ -128,6 +160,10 @@ namespace SpatialIndex
 
 			uint32_t m_totalDataLength;
 
+			bool m_bResident;
+				// Set while the node belongs to the tree's resident nodes, which
+				// free it themselves rather than through the pool.
+
 			class RstarSplitEntry
 			{
 			public:
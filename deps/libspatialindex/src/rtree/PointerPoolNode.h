@@ -38,6 +38,9 @@ namespace Tools
 	public:
 		explicit PointerPool(uint32_t capacity) : m_capacity(capacity)
 		{
+			#if HAVE_PTHREAD_H
+			pthread_mutex_init(&m_lock, NULL);
+			#endif
 			#ifndef NDEBUG
 			m_hits = 0;
 			m_misses = 0;
@@ -61,18 +64,26 @@ namespace Tools
 			#ifndef NDEBUG
 			std::cerr << "Lost pointers: " << m_pointerCount << std::endl;
 			#endif
+
+			#if HAVE_PTHREAD_H
+			pthread_mutex_destroy(&m_lock);
+			#endif
 		}
 
 		PoolPointer<RTree::Node> acquire()
 		{
+			RTree::Node* p = 0;
+
+			#if HAVE_PTHREAD_H
+			pthread_mutex_lock(&m_lock);
+			#endif
+
 			if (! m_pool.empty())
 			{
-				RTree::Node* p = m_pool.top(); m_pool.pop();
+				p = m_pool.top(); m_pool.pop();
 				#ifndef NDEBUG
 				++m_hits;
 				#endif
-
-				return PoolPointer<RTree::Node>(p, this);
 			}
 			#ifndef NDEBUG
 			else
@@ -83,6 +94,11 @@ namespace Tools
 			}
 			#endif
 
+			#if HAVE_PTHREAD_H
+			pthread_mutex_unlock(&m_lock);
+			#endif
+
+			if (p != 0) return PoolPointer<RTree::Node>(p, this);
 			return PoolPointer<RTree::Node>();
 		}
 
@@ -90,35 +106,44 @@ namespace Tools
 		{
 			if (p != 0)
 			{
-				if (m_pool.size() < m_capacity)
+				// resident nodes are only freed by their tree.
+				if (p->m_bResident) return;
+
+				// the payloads are freed outside the lock, and a node that does
+				// not fit in the pool is then deleted with no children left
+				if (p->m_pData != 0)
 				{
-					if (p->m_pData != 0)
+					for (uint32_t cChild = 0; cChild < p->m_children; ++cChild)
 					{
-						for (uint32_t cChild = 0; cChild < p->m_children; ++cChild)
-						{
-							// there is no need to set the pointer to zero, after deleting it,
-							// since it will be redeleted only if it is actually initialized again,
-							// a fact that will be depicted by variable m_children.
-							if (p->m_pData[cChild] != 0) delete[] p->m_pData[cChild];
-						}
+						// there is no need to set the pointer to zero, after deleting it,
+						// since it will be redeleted only if it is actually initialized again,
+						// a fact that will be depicted by variable m_children.
+						if (p->m_pData[cChild] != 0) delete[] p->m_pData[cChild];
 					}
+				}
 
-					p->m_level = 0;
-					p->m_identifier = -1;
-					p->m_children = 0;
-					p->m_totalDataLength = 0;
+				p->m_level = 0;
+				p->m_identifier = -1;
+				p->m_children = 0;
+				p->m_totalDataLength = 0;
 
-					m_pool.push(p);
-				}
-				else
-				{
-					#ifndef NDEBUG
-					--m_pointerCount;
-					#endif
-					delete p;
-				}
+				#if HAVE_PTHREAD_H
+				pthread_mutex_lock(&m_lock);
+				#endif
+
+				bool bPooled = m_pool.size() < m_capacity;
+				if (bPooled) m_pool.push(p);
+				#ifndef NDEBUG
+				else --m_pointerCount;
+				#endif
 
 				assert(m_pool.size() <= m_capacity);
+
+				#if HAVE_PTHREAD_H
+				pthread_mutex_unlock(&m_lock);
+				#endif
+
+				if (! bPooled) delete p;
 			}
 		}
 
@@ -132,6 +157,9 @@ namespace Tools
 	protected:
 		uint32_t m_capacity;
 		std::stack<RTree::Node*> m_pool;
+		#if HAVE_PTHREAD_H
+		pthread_mutex_t m_lock;
+		#endif
 
 	#ifndef NDEBUG
 	public:
@@ -25,9 +25,11 @@
  * DEALINGS IN THE SOFTWARE.
 ******************************************************************************/
 
+#include <algorithm>
 #include <cstring>
 #include <cmath>
 #include <limits>
+#include <typeinfo>
 
 #include <spatialindex/SpatialIndex.h>
 #include "Node.h"
@@ -139,20 +141,26 @@ void SpatialIndex::RTree::Data::storeToByteArray(byte** data, uint32_t& len)
 	// ptr += regionsize;
 }
 
+SpatialIndex::RTree::QueryPosition::QueryPosition()
+	: m_bStarted(false), m_bResumable(true), m_leaf(-1), m_child(0), m_modifications(0)
+{
+}
+
 SpatialIndex::ISpatialIndex* SpatialIndex::RTree::returnRTree(SpatialIndex::IStorageManager& sm, Tools::PropertySet& ps)
 {
 	SpatialIndex::ISpatialIndex* si = new SpatialIndex::RTree::RTree(sm, ps);
 	return si;
 }
 
-SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createNewRTree(
+static SpatialIndex::ISpatialIndex* newRTree(
 	SpatialIndex::IStorageManager& sm,
 	double fillFactor,
 	uint32_t indexCapacity,
 	uint32_t leafCapacity,
 	uint32_t dimension,
-	RTreeVariant rv,
-	id_type& indexIdentifier)
+	SpatialIndex::RTree::RTreeVariant rv,
+	bool bResidentNodes,
+	SpatialIndex::id_type& indexIdentifier)
 {
 	Tools::Variant var;
 	Tools::PropertySet ps;
@@ -177,7 +185,11 @@ SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createNewRTree(
 	var.m_val.lVal = rv;
 	ps.setProperty("TreeVariant", var);
 
-	ISpatialIndex* ret = returnRTree(sm, ps);
+	var.m_varType = Tools::VT_BOOL;
+	var.m_val.blVal = bResidentNodes;
+	ps.setProperty("ResidentNodes", var);
+
+	SpatialIndex::ISpatialIndex* ret = SpatialIndex::RTree::returnRTree(sm, ps);
 
 	var.m_varType = Tools::VT_LONGLONG;
 	var = ps.getProperty("IndexIdentifier");
@@ -186,6 +198,18 @@ SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createNewRTree(
 	return ret;
 }
 
+SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createNewRTree(
+	SpatialIndex::IStorageManager& sm,
+	double fillFactor,
+	uint32_t indexCapacity,
+	uint32_t leafCapacity,
+	uint32_t dimension,
+	RTreeVariant rv,
+	id_type& indexIdentifier)
+{
+	return newRTree(sm, fillFactor, indexCapacity, leafCapacity, dimension, rv, false, indexIdentifier);
+}
+
 SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createAndBulkLoadNewRTree(
 	BulkLoadMethod m,
 	IDataStream& stream,
@@ -195,9 +219,10 @@ SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createAndBulkLoadNewRTree(
 	uint32_t leafCapacity,
 	uint32_t dimension,
 	SpatialIndex::RTree::RTreeVariant rv,
-	id_type& indexIdentifier)
+	id_type& indexIdentifier,
+	bool bResidentNodes)
 {
-	SpatialIndex::ISpatialIndex* tree = createNewRTree(sm, fillFactor, indexCapacity, leafCapacity, dimension, rv, indexIdentifier);
+	SpatialIndex::ISpatialIndex* tree = newRTree(sm, fillFactor, indexCapacity, leafCapacity, dimension, rv, bResidentNodes, indexIdentifier);
 
 	uint32_t bindex = static_cast<uint32_t>(std::floor(static_cast<double>(indexCapacity * fillFactor)));
 	uint32_t bleaf = static_cast<uint32_t>(std::floor(static_cast<double>(leafCapacity * fillFactor)));
@@ -322,7 +347,18 @@ SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createAndBulkLoadNewRTree(
 		numberOfPages = var.m_val.ulVal;
 	}
 
-	SpatialIndex::ISpatialIndex* tree = createNewRTree(sm, fillFactor, indexCapacity, leafCapacity, dimension, rv, indexIdentifier);
+	// resident nodes
+	bool bResidentNodes = false;
+	var = ps.getProperty("ResidentNodes");
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_BOOL)
+			throw Tools::IllegalArgumentException("createAndBulkLoadNewRTree: Property ResidentNodes must be Tools::VT_BOOL");
+
+		bResidentNodes = var.m_val.blVal;
+	}
+
+	SpatialIndex::ISpatialIndex* tree = newRTree(sm, fillFactor, indexCapacity, leafCapacity, dimension, rv, bResidentNodes, indexIdentifier);
 
 	uint32_t bindex = static_cast<uint32_t>(std::floor(static_cast<double>(indexCapacity * fillFactor)));
 	uint32_t bleaf = static_cast<uint32_t>(std::floor(static_cast<double>(leafCapacity * fillFactor)));
@@ -354,6 +390,14 @@ SpatialIndex::ISpatialIndex* SpatialIndex::RTree::loadRTree(IStorageManager& sm,
 	return returnRTree(sm, ps);
 }
 
+void SpatialIndex::RTree::resumeIntersectsWithQuery(ISpatialIndex& index, const IShape& query, IVisitor& v, QueryPosition& position)
+{
+	RTree* pTree = dynamic_cast<RTree*>(&index);
+	if (pTree == 0) throw Tools::IllegalArgumentException("resumeIntersectsWithQuery: Index is not an RTree.");
+	if (query.getDimension() != pTree->m_dimension) throw Tools::IllegalArgumentException("resumeIntersectsWithQuery: Shape has the wrong number of dimensions.");
+	pTree->rangeQuery(IntersectionQuery, query, v, position);
+}
+
 SpatialIndex::RTree::RTree::RTree(IStorageManager& sm, Tools::PropertySet& ps) :
 	m_pStorageManager(&sm),
 	m_rootID(StorageManager::NewPage),
@@ -367,13 +411,15 @@ SpatialIndex::RTree::RTree::RTree(IStorageManager& sm, Tools::PropertySet& ps) :
 	m_reinsertFactor(0.3),
 	m_dimension(2),
 	m_bTightMBRs(true),
+	m_bResidentNodes(false),
+	m_modifications(0),
 	m_pointPool(500),
 	m_regionPool(1000),
 	m_indexPool(100),
 	m_leafPool(100)
 {
 #ifdef HAVE_PTHREAD_H
-	pthread_mutex_init(&m_lock, NULL);
+	Tools::initSharedLock(&m_rwLock);
 #endif
 
 	Tools::Variant var = ps.getProperty("IndexIdentifier");
@@ -398,10 +444,16 @@ SpatialIndex::RTree::RTree::RTree(IStorageManager& sm, Tools::PropertySet& ps) :
 SpatialIndex::RTree::RTree::~RTree()
 {
 #ifdef HAVE_PTHREAD_H
-	pthread_mutex_destroy(&m_lock);
+	pthread_rwlock_destroy(&m_rwLock);
 #endif
 
 	storeHeader();
+
+	for (size_t cNode = 0; cNode < m_residentNodes.size(); ++cNode)
+	{
+		if (m_residentNodes[cNode] != 0) m_retiredNodes.insert(m_residentNodes[cNode]);
+	}
+	releaseRetiredNodes();
 }
 
 //
@@ -413,7 +465,7 @@ void SpatialIndex::RTree::RTree::insertData(uint32_t len, const byte* pData, con
 	if (shape.getDimension() != m_dimension) throw Tools::IllegalArgumentException("insertData: Shape has the wrong number of dimensions.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::ExclusiveLockGuard lock(&m_rwLock);
 #endif
 
 	// convert the shape into a Region (R-Trees index regions only; i.e., approximations of the shapes).
@@ -430,6 +482,8 @@ void SpatialIndex::RTree::RTree::insertData(uint32_t len, const byte* pData, con
 
 	insertData_impl(len, buffer, *mbr, id);
 		// the buffer is stored in the tree. Do not delete here.
+
+	releaseRetiredNodes();
 }
 
 bool SpatialIndex::RTree::RTree::deleteData(const IShape& shape, id_type id)
@@ -437,13 +491,15 @@ bool SpatialIndex::RTree::RTree::deleteData(const IShape& shape, id_type id)
 	if (shape.getDimension() != m_dimension) throw Tools::IllegalArgumentException("deleteData: Shape has the wrong number of dimensions.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::ExclusiveLockGuard lock(&m_rwLock);
 #endif
 
 	RegionPtr mbr = m_regionPool.acquire();
 	shape.getMBR(*mbr);
 	bool ret = deleteData_impl(*mbr, id);
 
+	releaseRetiredNodes();
+
 	return ret;
 }
 
@@ -453,7 +509,7 @@ void SpatialIndex::RTree::RTree::containsWhatQuery(const IShape& query, IVisitor
 	if (query.getDimension() != m_dimension) throw Tools::IllegalArgumentException("containsWhatQuery: Shape has the wrong number of dimensions.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::SharedLockGuard lock(&m_rwLock);
 #endif
 
 	try
@@ -476,7 +532,7 @@ void SpatialIndex::RTree::RTree::containsWhatQuery(const IShape& query, IVisitor
 					{
 						Data data = Data(n->m_pDataLength[cChild], n->m_pData[cChild], *(n->m_ptrMBR[cChild]), n->m_pIdentifier[cChild]);
 						v.visitData(data);
-						++(m_stats.m_u64QueryResults);
+						Tools::atomicAdd(m_stats.m_u64QueryResults, 1);
 					}
 				}
 			}
@@ -522,9 +578,28 @@ void SpatialIndex::RTree::RTree::nearestNeighborQuery(uint32_t k, const IShape&
 	if (query.getDimension() != m_dimension) throw Tools::IllegalArgumentException("nearestNeighborQuery: Shape has the wrong number of dimensions.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::SharedLockGuard lock(&m_rwLock);
 #endif
 
+	// the default comparator measures plain distances to points and regions, which are
+	// computed for all the children of a node at once.
+	const double* pLow = 0;
+	const double* pHigh = 0;
+	if (typeid(nnc) == typeid(NNComparator))
+	{
+		if (typeid(query) == typeid(Region))
+		{
+			pLow = dynamic_cast<const Region&>(query).m_pLow;
+			pHigh = dynamic_cast<const Region&>(query).m_pHigh;
+		}
+		else if (typeid(query) == typeid(Point))
+		{
+			pLow = pHigh = dynamic_cast<const Point&>(query).m_pCoords;
+		}
+	}
+	std::vector<double> distances;
+	if (pLow != 0) distances.resize(std::max(m_indexCapacity, m_leafCapacity) + 1);
+
 	std::priority_queue<NNEntry*, std::vector<NNEntry*>, NNEntry::ascending> queue;
 
 	queue.push(new NNEntry(m_rootID, 0, 0.0));
@@ -548,25 +623,32 @@ void SpatialIndex::RTree::RTree::nearestNeighborQuery(uint32_t k, const IShape&
 			NodePtr n = readNode(pFirst->m_id);
 			v.visitNode(*n);
 
+			if (pLow != 0) n->getChildMinimumDistances(pLow, pHigh, &(distances[0]));
+
 			for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
 			{
+				// entries at an infinite distance can never be reported, so they are not queued.
+				// This lets a comparator prune everything beyond a cutoff distance.
 				if (n->m_level == 0)
 				{
 					Data* e = new Data(n->m_pDataLength[cChild], n->m_pData[cChild], *(n->m_ptrMBR[cChild]), n->m_pIdentifier[cChild]);
 					// we need to compare the query with the actual data entry here, so we call the
 					// appropriate getMinimumDistance method of NearestNeighborComparator.
-					queue.push(new NNEntry(n->m_pIdentifier[cChild], e, nnc.getMinimumDistance(query, *e)));
+					double dist = (pLow != 0) ? distances[cChild] : nnc.getMinimumDistance(query, *e);
+					if (dist == std::numeric_limits<double>::infinity()) delete e;
+					else queue.push(new NNEntry(n->m_pIdentifier[cChild], e, dist));
 				}
 				else
 				{
-					queue.push(new NNEntry(n->m_pIdentifier[cChild], 0, nnc.getMinimumDistance(query, *(n->m_ptrMBR[cChild]))));
+					double dist = (pLow != 0) ? distances[cChild] : nnc.getMinimumDistance(query, *(n->m_ptrMBR[cChild]));
+					if (dist != std::numeric_limits<double>::infinity()) queue.push(new NNEntry(n->m_pIdentifier[cChild], 0, dist));
 				}
 			}
 		}
 		else
 		{
 			v.visitData(*(static_cast<IData*>(pFirst->m_pEntry)));
-			++(m_stats.m_u64QueryResults);
+			Tools::atomicAdd(m_stats.m_u64QueryResults, 1);
 			++count;
 			knearest = pFirst->m_minDist;
 			delete pFirst->m_pEntry;
@@ -597,7 +679,7 @@ void SpatialIndex::RTree::RTree::selfJoinQuery(const IShape& query, IVisitor& v)
 		throw Tools::IllegalArgumentException("selfJoinQuery: Shape has the wrong number of dimensions.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::SharedLockGuard lock(&m_rwLock);
 #endif
 
 	RegionPtr mbr = m_regionPool.acquire();
@@ -608,7 +690,7 @@ void SpatialIndex::RTree::RTree::selfJoinQuery(const IShape& query, IVisitor& v)
 void SpatialIndex::RTree::RTree::queryStrategy(IQueryStrategy& qs)
 {
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::SharedLockGuard lock(&m_rwLock);
 #endif
 
 	id_type next = m_rootID;
@@ -670,6 +752,11 @@ void SpatialIndex::RTree::RTree::getIndexProperties(Tools::PropertySet& out) con
 	var.m_val.blVal = m_bTightMBRs;
 	out.setProperty("EnsureTightMBRs", var);
 
+	// resident nodes
+	var.m_varType = Tools::VT_BOOL;
+	var.m_val.blVal = m_bResidentNodes;
+	out.setProperty("ResidentNodes", var);
+
 	// index pool capacity
 	var.m_varType = Tools::VT_ULONG;
 	var.m_val.ulVal = m_indexPool.getCapacity();
@@ -935,6 +1022,16 @@ void SpatialIndex::RTree::RTree::initNew(Tools::PropertySet& ps)
 		m_bTightMBRs = var.m_val.blVal;
 	}
 
+	// resident nodes
+	var = ps.getProperty("ResidentNodes");
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_BOOL)
+			throw Tools::IllegalArgumentException("initNew: Property ResidentNodes must be Tools::VT_BOOL");
+
+		m_bResidentNodes = var.m_val.blVal;
+	}
+
 	// index pool capacity
 	var = ps.getProperty("IndexPoolCapacity");
 	if (var.m_varType != Tools::VT_EMPTY)
@@ -976,12 +1073,21 @@ void SpatialIndex::RTree::RTree::initNew(Tools::PropertySet& ps)
 	}
 
 	m_infiniteRegion.makeInfinite(m_dimension);
+	m_kernels = ChildKernels::select(m_dimension);
 
 	m_stats.m_u32TreeHeight = 1;
 	m_stats.m_nodesInLevel.push_back(0);
 
-	Leaf root(this, -1);
-	m_rootID = writeNode(&root);
+	if (m_bResidentNodes)
+	{
+		// the resident nodes own what is written to them.
+		m_rootID = writeNode(new Leaf(this, -1));
+	}
+	else
+	{
+		Leaf root(this, -1);
+		m_rootID = writeNode(&root);
+	}
 
 	storeHeader();
 }
@@ -1089,6 +1195,7 @@ void SpatialIndex::RTree::RTree::initOld(Tools::PropertySet& ps)
 	}
 
 	m_infiniteRegion.makeInfinite(m_dimension);
+	m_kernels = ChildKernels::select(m_dimension);
 }
 
 void SpatialIndex::RTree::RTree::storeHeader()
@@ -1275,24 +1382,31 @@ bool SpatialIndex::RTree::RTree::deleteData_impl(const Region& mbr, id_type id)
 
 SpatialIndex::id_type SpatialIndex::RTree::RTree::writeNode(Node* n)
 {
-	byte* buffer;
-	uint32_t dataLength;
-	n->storeToByteArray(&buffer, dataLength);
-
 	id_type page;
 	if (n->m_identifier < 0) page = StorageManager::NewPage;
 	else page = n->m_identifier;
 
-	try
+	if (m_bResidentNodes)
 	{
-		m_pStorageManager->storeByteArray(page, dataLength, buffer);
-		delete[] buffer;
+		storeResidentNode(page, n);
 	}
-	catch (InvalidPageException& e)
+	else
 	{
-		delete[] buffer;
-		std::cerr << e.what() << std::endl;
-		throw;
+		byte* buffer;
+		uint32_t dataLength;
+		n->storeToByteArray(&buffer, dataLength);
+
+		try
+		{
+			m_pStorageManager->storeByteArray(page, dataLength, buffer);
+			delete[] buffer;
+		}
+		catch (InvalidPageException& e)
+		{
+			delete[] buffer;
+			std::cerr << e.what() << std::endl;
+			throw;
+		}
 	}
 
 	if (n->m_identifier < 0)
@@ -1315,6 +1429,7 @@ SpatialIndex::id_type SpatialIndex::RTree::RTree::writeNode(Node* n)
 	}
 
 	++(m_stats.m_u64Writes);
+	++m_modifications;
 
 	for (size_t cIndex = 0; cIndex < m_writeNodeCommands.size(); ++cIndex)
 	{
@@ -1326,18 +1441,29 @@ SpatialIndex::id_type SpatialIndex::RTree::RTree::writeNode(Node* n)
 
 SpatialIndex::RTree::NodePtr SpatialIndex::RTree::RTree::readNode(id_type page)
 {
+	if (m_bResidentNodes)
+	{
+		if (page < 0 || page >= static_cast<id_type>(m_residentNodes.size()) || m_residentNodes[page] == 0)
+			throw InvalidPageException(page);
+
+		// the caller gets the live node, the pool ignores its release.
+		Node* p = m_residentNodes[page];
+		NodePtr n(p, p->isLeaf() ? &m_leafPool : &m_indexPool);
+
+		Tools::atomicAdd(m_stats.m_u64Reads, 1);
+
+		for (size_t cIndex = 0; cIndex < m_readNodeCommands.size(); ++cIndex)
+		{
+			m_readNodeCommands[cIndex]->execute(*n);
+		}
+
+		return n;
+	}
+
 	uint32_t dataLength;
 	byte* buffer;
 
-	try
-	{
-		m_pStorageManager->loadByteArray(page, dataLength, &buffer);
-	}
-	catch (InvalidPageException& e)
-	{
-		std::cerr << e.what() << std::endl;
-		throw;
-	}
+	m_pStorageManager->loadByteArray(page, dataLength, &buffer);
 
 	try
 	{
@@ -1360,7 +1486,7 @@ SpatialIndex::RTree::NodePtr SpatialIndex::RTree::RTree::readNode(id_type page)
 		n->m_identifier = page;
 		n->loadFromByteArray(buffer);
 
-		++(m_stats.m_u64Reads);
+		Tools::atomicAdd(m_stats.m_u64Reads, 1);
 
 		for (size_t cIndex = 0; cIndex < m_readNodeCommands.size(); ++cIndex)
 		{
@@ -1379,18 +1505,26 @@ SpatialIndex::RTree::NodePtr SpatialIndex::RTree::RTree::readNode(id_type page)
 
 void SpatialIndex::RTree::RTree::deleteNode(Node* n)
 {
-	try
+	if (m_bResidentNodes)
 	{
-		m_pStorageManager->deleteByteArray(n->m_identifier);
+		deleteResidentNode(n->m_identifier);
 	}
-	catch (InvalidPageException& e)
+	else
 	{
-		std::cerr << e.what() << std::endl;
-		throw;
+		try
+		{
+			m_pStorageManager->deleteByteArray(n->m_identifier);
+		}
+		catch (InvalidPageException& e)
+		{
+			std::cerr << e.what() << std::endl;
+			throw;
+		}
 	}
 
 	--(m_stats.m_u32Nodes);
 	m_stats.m_nodesInLevel[n->m_level] = m_stats.m_nodesInLevel[n->m_level] - 1;
+	++m_modifications;
 
 	for (size_t cIndex = 0; cIndex < m_deleteNodeCommands.size(); ++cIndex)
 	{
@@ -1398,36 +1532,171 @@ void SpatialIndex::RTree::RTree::deleteNode(Node* n)
 	}
 }
 
+void SpatialIndex::RTree::RTree::storeResidentNode(id_type& page, Node* n)
+{
+	if (page == StorageManager::NewPage)
+	{
+		if (m_emptyResidentNodes.empty())
+		{
+			m_residentNodes.push_back(n);
+			page = static_cast<id_type>(m_residentNodes.size() - 1);
+		}
+		else
+		{
+			page = m_emptyResidentNodes.top(); m_emptyResidentNodes.pop();
+			m_residentNodes[page] = n;
+		}
+	}
+	else
+	{
+		if (page < 0 || page >= static_cast<id_type>(m_residentNodes.size()) || m_residentNodes[page] == 0)
+			throw InvalidPageException(page);
+
+		// a split writes a new node in place of the one it read.
+		if (m_residentNodes[page] != n) m_retiredNodes.insert(m_residentNodes[page]);
+		m_residentNodes[page] = n;
+	}
+
+	n->m_bResident = true;
+	m_retiredNodes.erase(n);
+}
+
+void SpatialIndex::RTree::RTree::deleteResidentNode(id_type page)
+{
+	if (page < 0 || page >= static_cast<id_type>(m_residentNodes.size()) || m_residentNodes[page] == 0)
+		throw InvalidPageException(page);
+
+	m_retiredNodes.insert(m_residentNodes[page]);
+	m_residentNodes[page] = 0;
+	m_emptyResidentNodes.push(page);
+}
+
+void SpatialIndex::RTree::RTree::releaseRetiredNodes()
+{
+	for (std::set<Node*>::iterator it = m_retiredNodes.begin(); it != m_retiredNodes.end(); ++it)
+	{
+		Node* n = *it;
+		n->m_bResident = false;
+
+		if (n->isLeaf()) m_leafPool.release(n);
+		else m_indexPool.release(n);
+	}
+
+	m_retiredNodes.clear();
+}
+
+// the identifier, MBR and data of a leaf entry, packed into one comparable key.
+static std::string entryKey(id_type id, const Region& r, uint32_t dataLength, const byte* pData)
+{
+	std::string key(reinterpret_cast<const char*>(&id), sizeof(id_type));
+	key.append(reinterpret_cast<const char*>(r.m_pLow), r.m_dimension * sizeof(double));
+	key.append(reinterpret_cast<const char*>(r.m_pHigh), r.m_dimension * sizeof(double));
+	if (dataLength > 0) key.append(reinterpret_cast<const char*>(pData), dataLength);
+	return key;
+}
+
 void SpatialIndex::RTree::RTree::rangeQuery(RangeQueryType type, const IShape& query, IVisitor& v)
+{
+	QueryPosition position;
+	position.m_bResumable = false;
+	rangeQuery(type, query, v, position);
+}
+
+void SpatialIndex::RTree::RTree::rangeQuery(RangeQueryType type, const IShape& query, IVisitor& v, QueryPosition& position)
 {
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::SharedLockGuard lock(&m_rwLock);
 #endif
 
-	std::stack<NodePtr> st;
-	NodePtr root = readNode(m_rootID);
+	IBoundedVisitor* pBounded = dynamic_cast<IBoundedVisitor*>(&v);
 
-	if (root->m_children > 0 && query.intersectsShape(root->m_nodeMBR)) st.push(root);
+	// regions, by far the most common query, are tested against all the children of
+	// a node at once.
+	const Region* pRegion = (typeid(query) == typeid(Region) && query.getDimension() == m_dimension) ? dynamic_cast<const Region*>(&query) : 0;
+	std::vector<uint64_t> hits;
+	if (pRegion != 0) hits.resize((std::max(m_indexCapacity, m_leafCapacity) + 64) / 64);
 
-	while (! st.empty())
+	// the pending nodes are kept as identifiers on the position, so that a query
+	// ended by its visitor can be resumed by a later call. A write in between may
+	// have split, merged or reused any of them, so the query then starts over and
+	// skips the items it has already given to the visitor.
+	bool bResumed = position.m_bStarted;
+	if (bResumed && position.m_modifications != m_modifications && (position.m_leaf != -1 || ! position.m_pending.empty()))
 	{
-		NodePtr n = st.top(); st.pop();
+		position.m_skipped = std::multiset<std::string>(position.m_visited.begin(), position.m_visited.end());
+		position.m_pending.clear();
+		position.m_leaf = -1;
+		bResumed = false;
+	}
+	position.m_bStarted = true;
+	position.m_modifications = m_modifications;
+
+	NodePtr n;
+	uint32_t cStart = 0;
+
+	if (position.m_leaf != -1)
+	{
+		n = readNode(position.m_leaf);
+		cStart = position.m_child;
+		position.m_leaf = -1;
+	}
+	else if (! bResumed)
+	{
+		NodePtr root = readNode(m_rootID);
+		if (root->m_children > 0 && query.intersectsShape(root->m_nodeMBR)) n = root;
+	}
+
+	while (true)
+	{
+		if (n.get() == 0)
+		{
+			if (position.m_pending.empty()) break;
+
+			n = readNode(position.m_pending.back());
+			position.m_pending.pop_back();
+		}
 
 		if (n->m_level == 0)
 		{
-			v.visitNode(*n);
+			if (cStart == 0) v.visitNode(*n);
 
-			for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+			if (pRegion != 0) n->getChildHits(pRegion->m_pLow, pRegion->m_pHigh, type == ContainmentQuery, &(hits[0]));
+
+			for (uint32_t cChild = cStart; cChild < n->m_children; ++cChild)
 			{
 				bool b;
-				if (type == ContainmentQuery) b = query.containsShape(*(n->m_ptrMBR[cChild]));
+				if (pRegion != 0) b = ((hits[cChild >> 6] >> (cChild & 63)) & 1) != 0;
+				else if (type == ContainmentQuery) b = query.containsShape(*(n->m_ptrMBR[cChild]));
 				else b = query.intersectsShape(*(n->m_ptrMBR[cChild]));
 
+				if (b && position.m_bResumable)
+				{
+					// entries with the same identifier are distinct items, so the data and MBR
+					// are part of what tells a visited entry apart.
+					std::string entry = entryKey(n->m_pIdentifier[cChild], *(n->m_ptrMBR[cChild]), n->m_pDataLength[cChild], n->m_pData[cChild]);
+					std::multiset<std::string>::iterator it = position.m_skipped.find(entry);
+					if (it != position.m_skipped.end())
+					{
+						position.m_skipped.erase(it);
+						b = false;
+					}
+					else position.m_visited.push_back(entry);
+				}
+
 				if (b)
 				{
 					Data data = Data(n->m_pDataLength[cChild], n->m_pData[cChild], *(n->m_ptrMBR[cChild]), n->m_pIdentifier[cChild]);
 					v.visitData(data);
-					++(m_stats.m_u64QueryResults);
+					Tools::atomicAdd(m_stats.m_u64QueryResults, 1);
+					if (pBounded != 0 && pBounded->isDone())
+					{
+						if (cChild + 1 < n->m_children)
+						{
+							position.m_leaf = n->m_identifier;
+							position.m_child = cChild + 1;
+						}
+						return;
+					}
 				}
 			}
 		}
@@ -1435,11 +1704,26 @@ void SpatialIndex::RTree::RTree::rangeQuery(RangeQueryType type, const IShape& q
 		{
 			v.visitNode(*n);
 
-			for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+			if (pRegion != 0)
 			{
-				if (query.intersectsShape(*(n->m_ptrMBR[cChild]))) st.push(readNode(n->m_pIdentifier[cChild]));
+				n->getChildHits(pRegion->m_pLow, pRegion->m_pHigh, false, &(hits[0]));
+
+				for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+				{
+					if ((hits[cChild >> 6] >> (cChild & 63)) & 1) position.m_pending.push_back(n->m_pIdentifier[cChild]);
+				}
+			}
+			else
+			{
+				for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+				{
+					if (query.intersectsShape(*(n->m_ptrMBR[cChild]))) position.m_pending.push_back(n->m_pIdentifier[cChild]);
+				}
 			}
 		}
+
+		n = NodePtr();
+		cStart = 0;
 	}
 }
 
@@ -1501,7 +1785,7 @@ void SpatialIndex::RTree::RTree::visitSubTree(NodePtr subTree, IVisitor& v)
 			{
 				Data data = Data(n->m_pDataLength[cChild], n->m_pData[cChild], *(n->m_ptrMBR[cChild]), n->m_pIdentifier[cChild]);
 				v.visitData(data);
-				++(m_stats.m_u64QueryResults);
+				Tools::atomicAdd(m_stats.m_u64QueryResults, 1);
 			}
 		}
 		else
@@ -59,6 +59,9 @@ namespace SpatialIndex
 				// LeafPoolCapacity         VT_LONG   Default is 100
 				// RegionPoolCapacity       VT_LONG   Default is 1000
 				// PointPoolCapacity        VT_LONG   Default is 500
+				// ResidentNodes            VT_BOOL   Keep the nodes of a new index decoded in memory instead of
+				//                          serializing them to the storage manager, which then only holds
+				//                          the header. For storage that is not persisted. Default is false
 
 			virtual ~RTree();
 
@@ -96,7 +99,12 @@ namespace SpatialIndex
 			NodePtr readNode(id_type page);
 			void deleteNode(Node*);
 
+			void storeResidentNode(id_type& page, Node* n);
+			void deleteResidentNode(id_type page);
+			void releaseRetiredNodes();
+
 			void rangeQuery(RangeQueryType type, const IShape& query, IVisitor& v);
+			void rangeQuery(RangeQueryType type, const IShape& query, IVisitor& v, QueryPosition& position);
 			void selfJoinQuery(id_type id1, id_type id2, const Region& r, IVisitor& vis);
             void visitSubTree(NodePtr subTree, IVisitor& v);
             
@@ -129,12 +137,30 @@ namespace SpatialIndex
 
 			uint32_t m_dimension;
 
+			ChildKernels m_kernels;
+				// The scans over the children of a node, chosen for m_dimension.
+
 			Region m_infiniteRegion;
 
 			Statistics m_stats;
 
 			bool m_bTightMBRs;
 
+			bool m_bResidentNodes;
+
+			std::vector<Node*> m_residentNodes;
+				// With ResidentNodes, the nodes indexed by identifier, in place of the storage manager's pages.
+
+			std::stack<id_type> m_emptyResidentNodes;
+
+			uint64_t m_modifications;
+				// Bumped by every node written or deleted, so that a resumed query can tell
+				// that the node identifiers it kept may no longer mean what they did.
+
+			std::set<Node*> m_retiredNodes;
+				// Resident nodes replaced or deleted by a write. The write may still hold
+				// them, so they are freed once it is over.
+
 			Tools::PointerPool<Point> m_pointPool;
 			Tools::PointerPool<Region> m_regionPool;
 			Tools::PointerPool<Node> m_indexPool;
@@ -145,7 +171,7 @@ namespace SpatialIndex
 			std::vector<Tools::SmartPointer<ICommand> > m_deleteNodeCommands;
 
 #ifdef HAVE_PTHREAD_H
-			pthread_mutex_t m_lock;
+			pthread_rwlock_t m_rwLock;
 #endif
 
 			class NNEntry
@@ -196,6 +222,8 @@ namespace SpatialIndex
 			friend class Index;
 			friend class BulkLoader;
 
+			friend void resumeIntersectsWithQuery(ISpatialIndex& index, const IShape& query, IVisitor& v, QueryPosition& position);
+
 			friend std::ostream& operator<<(std::ostream& os, const RTree& t);
 		}; // RTree
 
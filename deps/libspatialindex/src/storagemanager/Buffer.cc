@@ -36,6 +36,10 @@ Buffer::Buffer(IStorageManager& sm, Tools::PropertySet& ps) :
 	m_pStorageManager(&sm),
 	m_u64Hits(0)
 {
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_init(&m_lock, NULL);
+#endif
+
 	Tools::Variant var = ps.getProperty("Capacity");
 	if (var.m_varType != Tools::VT_EMPTY)
 	{
@@ -54,23 +58,39 @@ Buffer::Buffer(IStorageManager& sm, Tools::PropertySet& ps) :
 Buffer::~Buffer()
 {
 	flush();
+
+	for (std::map<id_type, Entry*>::iterator it = m_buffer.begin(); it != m_buffer.end(); ++it)
+		delete (*it).second;
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_destroy(&m_lock);
+#endif
 }
 
+// Writes the dirty entries back and keeps every entry cached, clean from now on.
 void Buffer::flush()
 {
+#ifdef HAVE_PTHREAD_H
+	Tools::LockGuard lock(&m_lock);
+#endif
+
 	for (std::map<id_type, Entry*>::iterator it = m_buffer.begin(); it != m_buffer.end(); ++it)
 	{
 		if ((*it).second->m_bDirty)
 		{
 			id_type page = (*it).first;
 			m_pStorageManager->storeByteArray(page, (*it).second->m_length, (*it).second->m_pData);
+			(*it).second->m_bDirty = false;
 		}
-		delete (*it).second;
 	}
 }
 
 void Buffer::loadByteArray(const id_type page, uint32_t& len, byte** data)
 {
+#ifdef HAVE_PTHREAD_H
+	Tools::LockGuard lock(&m_lock);
+#endif
+
 	std::map<id_type, Entry*>::iterator it = m_buffer.find(page);
 
 	if (it != m_buffer.end())
@@ -89,6 +109,10 @@ void Buffer::loadByteArray(const id_type page, uint32_t& len, byte** data)
 
 void Buffer::storeByteArray(id_type& page, const uint32_t len, const byte* const data)
 {
+#ifdef HAVE_PTHREAD_H
+	Tools::LockGuard lock(&m_lock);
+#endif
+
 	if (page == NewPage)
 	{
 		m_pStorageManager->storeByteArray(page, len, data);
@@ -121,6 +145,10 @@ void Buffer::storeByteArray(id_type& page, const uint32_t len, const byte* const
 
 void Buffer::deleteByteArray(const id_type page)
 {
+#ifdef HAVE_PTHREAD_H
+	Tools::LockGuard lock(&m_lock);
+#endif
+
 	std::map<id_type, Entry*>::iterator it = m_buffer.find(page);
 	if (it != m_buffer.end())
 	{
@@ -133,6 +161,10 @@ void Buffer::deleteByteArray(const id_type page)
 
 void Buffer::clear()
 {
+#ifdef HAVE_PTHREAD_H
+	Tools::LockGuard lock(&m_lock);
+#endif
+
 	for (std::map<id_type, Entry*>::iterator it = m_buffer.begin(); it != m_buffer.end(); ++it)
 	{
 		if ((*it).second->m_bDirty)
@@ -150,5 +182,9 @@ void Buffer::clear()
 
 uint64_t Buffer::getHits()
 {
+#ifdef HAVE_PTHREAD_H
+	Tools::LockGuard lock(&m_lock);
+#endif
+
 	return m_u64Hits;
 }
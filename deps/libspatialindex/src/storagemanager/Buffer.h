@@ -80,6 +80,11 @@ namespace SpatialIndex
 			IStorageManager* m_pStorageManager;
 			std::map<id_type, Entry*> m_buffer;
 			uint64_t m_u64Hits;
+
+#ifdef HAVE_PTHREAD_H
+			// readers sharing the tree also share the buffer, and miss into it
+			pthread_mutex_t m_lock;
+#endif
 		}; // Buffer
 	}
 }
@@ -127,6 +127,10 @@ SpatialIndex::IStorageManager* SpatialIndex::StorageManager::loadDiskStorageMana
 
 DiskStorageManager::DiskStorageManager(Tools::PropertySet& ps) : m_pageSize(0), m_nextPage(-1), m_buffer(0)
 {
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_init(&m_lock, NULL);
+#endif
+
 	Tools::Variant var;
 
 	// Open/Create flag.
@@ -291,10 +295,18 @@ DiskStorageManager::~DiskStorageManager()
 
 	std::map<id_type, Entry*>::iterator it;
 	for (it = m_pageIndex.begin(); it != m_pageIndex.end(); ++it) delete (*it).second;
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_destroy(&m_lock);
+#endif
 }
 
 void DiskStorageManager::flush()
 {
+#ifdef HAVE_PTHREAD_H
+	Tools::LockGuard lock(&m_lock);
+#endif
+
 	m_indexFile.seekp(0, std::ios_base::beg);
 	if (m_indexFile.fail())
 		throw Tools::IllegalStateException("SpatialIndex::DiskStorageManager: Corrupted storage manager index file.");
@@ -353,6 +365,10 @@ void DiskStorageManager::flush()
 
 void DiskStorageManager::loadByteArray(const id_type page, uint32_t& len, byte** data)
 {
+#ifdef HAVE_PTHREAD_H
+	Tools::LockGuard lock(&m_lock);
+#endif
+
 	std::map<id_type, Entry*>::iterator it = m_pageIndex.find(page);
 
 	if (it == m_pageIndex.end())
@@ -391,6 +407,10 @@ void DiskStorageManager::loadByteArray(const id_type page, uint32_t& len, byte**
 
 void DiskStorageManager::storeByteArray(id_type& page, const uint32_t len, const byte* const data)
 {
+#ifdef HAVE_PTHREAD_H
+	Tools::LockGuard lock(&m_lock);
+#endif
+
 	if (page == NewPage)
 	{
 		Entry* e = new Entry();
@@ -501,6 +521,10 @@ void DiskStorageManager::storeByteArray(id_type& page, const uint32_t len, const
 
 void DiskStorageManager::deleteByteArray(const id_type page)
 {
+#ifdef HAVE_PTHREAD_H
+	Tools::LockGuard lock(&m_lock);
+#endif
+
 	std::map<id_type, Entry*>::iterator it = m_pageIndex.find(page);
 
 	if (it == m_pageIndex.end())
@@ -59,6 +59,11 @@ namespace SpatialIndex
 			std::map<id_type, Entry*> m_pageIndex;
 
 			byte* m_buffer;
+
+#ifdef HAVE_PTHREAD_H
+			// the files are read through a single position
+			pthread_mutex_t m_lock;
+#endif
 		}; // DiskStorageManager
 	}
 }
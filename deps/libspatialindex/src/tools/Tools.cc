@@ -661,6 +661,43 @@ Tools::LockGuard::~LockGuard()
 {
 	pthread_mutex_unlock(m_pLock);
 }
+
+Tools::SharedLockGuard::SharedLockGuard(pthread_rwlock_t* pLock)
+ : m_pLock(pLock)
+{
+	pthread_rwlock_rdlock(m_pLock);
+}
+
+Tools::SharedLockGuard::~SharedLockGuard()
+{
+	pthread_rwlock_unlock(m_pLock);
+}
+
+Tools::ExclusiveLockGuard::ExclusiveLockGuard(pthread_rwlock_t* pLock)
+ : m_pLock(pLock)
+{
+	pthread_rwlock_wrlock(m_pLock);
+}
+
+Tools::ExclusiveLockGuard::~ExclusiveLockGuard()
+{
+	pthread_rwlock_unlock(m_pLock);
+}
+
+void Tools::initSharedLock(pthread_rwlock_t* pLock)
+{
+#ifdef __GLIBC__
+	// glibc prefers readers by default; the other common libcs already queue
+	// new readers behind a waiting writer.
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init(&attr);
+	pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	pthread_rwlock_init(pLock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+#else
+	pthread_rwlock_init(pLock, NULL);
+#endif
+}
 #endif
 
 std::ostream& Tools::operator<<(std::ostream& os, const Tools::PropertySet& p)
@@ -222,7 +222,7 @@ SpatialIndex::TPRTree::TPRTree::TPRTree(IStorageManager& sm, Tools::PropertySet&
 	m_leafPool(100)
 {
 #ifdef HAVE_PTHREAD_H
-	pthread_mutex_init(&m_lock, NULL);
+	Tools::initSharedLock(&m_rwLock);
 #endif
 
 	Tools::Variant var = ps.getProperty("IndexIdentifier");
@@ -247,7 +247,7 @@ SpatialIndex::TPRTree::TPRTree::TPRTree(IStorageManager& sm, Tools::PropertySet&
 SpatialIndex::TPRTree::TPRTree::~TPRTree()
 {
 #ifdef HAVE_PTHREAD_H
-	pthread_mutex_destroy(&m_lock);
+	pthread_rwlock_destroy(&m_rwLock);
 #endif
 
 	storeHeader();
@@ -268,7 +268,7 @@ void SpatialIndex::TPRTree::TPRTree::insertData(uint32_t len, const byte* pData,
 	if (pivI->getLowerBound() < m_currentTime) throw Tools::IllegalArgumentException("insertData: Shape start time is older than tree current time.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::ExclusiveLockGuard lock(&m_rwLock);
 #endif
 
 	Region mbr;
@@ -311,7 +311,7 @@ bool SpatialIndex::TPRTree::TPRTree::deleteData(const IShape& shape, id_type id)
 	if (pivI == 0) throw Tools::IllegalArgumentException("insertData: Shape does not support the Tools::IInterval interface.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::ExclusiveLockGuard lock(&m_rwLock);
 #endif
 
 	Region mbr;
@@ -375,7 +375,7 @@ void SpatialIndex::TPRTree::TPRTree::selfJoinQuery(const IShape&, IVisitor&)
 void SpatialIndex::TPRTree::TPRTree::queryStrategy(IQueryStrategy& qs)
 {
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::SharedLockGuard lock(&m_rwLock);
 #endif
 
 	id_type next = m_rootID;
@@ -1174,7 +1174,7 @@ SpatialIndex::TPRTree::NodePtr SpatialIndex::TPRTree::TPRTree::readNode(id_type
 		n->m_identifier = id;
 		n->loadFromByteArray(buffer);
 
-		++(m_stats.m_reads);
+		Tools::atomicAdd(m_stats.m_reads, 1);
 
 		for (size_t cIndex = 0; cIndex < m_readNodeCommands.size(); ++cIndex)
 		{
@@ -1221,9 +1221,11 @@ void SpatialIndex::TPRTree::TPRTree::rangeQuery(RangeQueryType type, const IShap
 		throw Tools::IllegalArgumentException("rangeQuery: Query time interval does not intersect current horizon.");
 
 #ifdef HAVE_PTHREAD_H
-	Tools::LockGuard lock(&m_lock);
+	Tools::SharedLockGuard lock(&m_rwLock);
 #endif
 
+	IBoundedVisitor* pBounded = dynamic_cast<IBoundedVisitor*>(&v);
+
 	std::stack<NodePtr> st;
 	NodePtr root = readNode(m_rootID);
 
@@ -1247,7 +1249,8 @@ void SpatialIndex::TPRTree::TPRTree::rangeQuery(RangeQueryType type, const IShap
 				{
 					Data data = Data(n->m_pDataLength[cChild], n->m_pData[cChild], *(n->m_ptrMBR[cChild]), n->m_pIdentifier[cChild]);
 					v.visitData(data);
-					++(m_stats.m_queryResults);
+					Tools::atomicAdd(m_stats.m_queryResults, 1);
+					if (pBounded != 0 && pBounded->isDone()) return;
 				}
 			}
 		}
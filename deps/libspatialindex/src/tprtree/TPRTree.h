@@ -146,7 +146,7 @@ namespace SpatialIndex
 			std::vector<Tools::SmartPointer<ICommand> > m_deleteNodeCommands;
 
 #ifdef HAVE_PTHREAD_H
-			pthread_mutex_t m_lock;
+			pthread_rwlock_t m_rwLock;
 #endif
 
 			class NNEntry
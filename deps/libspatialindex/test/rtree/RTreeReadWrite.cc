@@ -0,0 +1,141 @@
+/******************************************************************************
+ * Project:  libspatialindex - A C++ library for spatial indexing
+ * Author:   Marios Hadjieleftheriou, mhadji@gmail.com
+ ******************************************************************************
+ * Copyright (c) 2002, Marios Hadjieleftheriou
+ *
+ * All rights reserved.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+******************************************************************************/
+
+// NOTE: Please read README.txt before browsing this code.
+
+// Checks that an insertion is not starved by readers that keep querying the
+// tree from other threads. Returns non-zero if the insertion does not finish
+// while the readers are running.
+
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+
+// include library header file.
+#include <spatialindex/SpatialIndex.h>
+
+using namespace SpatialIndex;
+
+#define READERS 4
+#define DEADLINE 10
+
+class CountVisitor : public IVisitor
+{
+public:
+	size_t m_count;
+
+	CountVisitor() : m_count(0) {}
+
+	void visitNode(const INode& n) {}
+
+	void visitData(const IData& d) { ++m_count; }
+
+	void visitData(std::vector<const IData*>& v) {}
+};
+
+static ISpatialIndex* tree;
+static volatile bool written = false;
+static time_t start;
+
+static void* reader(void*)
+{
+	double plow[2] = {0.0, 0.0};
+	double phigh[2] = {1.0, 1.0};
+	Region r(plow, phigh, 2);
+
+	// keep the tree read-locked by at least one reader at all times, until
+	// the writer is done or has clearly been starved.
+	while (! written && time(0) - start < DEADLINE)
+	{
+		CountVisitor vis;
+		tree->intersectsWithQuery(r, vis);
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		IStorageManager* memory = StorageManager::createNewMemoryStorageManager();
+
+		id_type indexIdentifier;
+		tree = RTree::createNewRTree(*memory, 0.7, 50, 50, 2, SpatialIndex::RTree::RV_RSTAR, indexIdentifier);
+
+		double plow[2], phigh[2];
+
+		for (id_type id = 0; id < 20000; ++id)
+		{
+			plow[0] = phigh[0] = (id % 200) / 200.0;
+			plow[1] = phigh[1] = (id / 200) / 100.0;
+			Region r = Region(plow, phigh, 2);
+			tree->insertData(0, 0, r, id);
+		}
+
+		start = time(0);
+
+		pthread_t threads[READERS];
+		for (int cThread = 0; cThread < READERS; ++cThread)
+			pthread_create(&threads[cThread], 0, reader, 0);
+
+		// give the readers a moment to pile up on the lock.
+		struct timespec ts = {0, 100000000};
+		nanosleep(&ts, 0);
+
+		plow[0] = phigh[0] = 0.5;
+		plow[1] = phigh[1] = 0.5;
+		Region r = Region(plow, phigh, 2);
+		tree->insertData(0, 0, r, 20000);
+
+		bool starved = (time(0) - start >= DEADLINE);
+		written = true;
+
+		for (int cThread = 0; cThread < READERS; ++cThread)
+			pthread_join(threads[cThread], 0);
+
+		delete tree;
+		delete memory;
+
+		if (starved)
+		{
+			std::cerr << "The insertion waited for the readers to run out." << std::endl;
+			return 1;
+		}
+
+		std::cerr << "The insertion finished while the readers were running." << std::endl;
+	}
+	catch (Tools::Exception& e)
+	{
+		std::cerr << "******ERROR******" << std::endl;
+		std::string s = e.what();
+		std::cerr << s << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -16,9 +16,40 @@
  * specific language governing permissions and limitations
  * under the License.
  */
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <map>
+#include <set>
 #include "libsidxjs.h"
 
-Nan::Persistent<v8::Function> SpatialIndex::constructor;
+// constructors are per addon instance so the module can load in several
+// worker threads
+struct AddonData {
+  napi_ref indexConstructor = NULL;
+  napi_ref cursorConstructor = NULL;
+  // completes the workers run on index executors, only keeps the loop alive
+  // while some are pending
+  napi_threadsafe_function completions = NULL;
+  uint32_t pending = 0;
+  // the index attach() is constructing, the only external the constructor
+  // accepts
+  SharedIndex* attaching = NULL;
+};
+
+AddonData* getAddonData(napi_env env);
+
+#define SIDX_MAX_ARGS 10
+#define SIDX_MAX_THREADS 64
+#define SIDX_WRITE_AFTER_READS 64
+#define SIDX_WRITE_AFTER_MS 50
 
 constexpr
 unsigned int hash(const char* str, int h = 0)
@@ -26,151 +57,1193 @@ unsigned int hash(const char* str, int h = 0)
   return !str[h] ? 5381 : (hash(str, h+1)*33) ^ str[h];
 }
 
-const char* ToCString(const v8::String::Utf8Value& value) {
-  return *value ? *value : "<string conversion failed>";
+napi_value jsNull(napi_env env) {
+  napi_value result;
+  napi_get_null(env, &result);
+  return result;
+}
+
+napi_value jsUndefined(napi_env env) {
+  napi_value result;
+  napi_get_undefined(env, &result);
+  return result;
+}
+
+napi_value jsNumber(napi_env env, double value) {
+  napi_value result;
+  napi_create_double(env, value, &result);
+  return result;
+}
+
+napi_value jsString(napi_env env, const std::string& value) {
+  napi_value result;
+  napi_create_string_utf8(env, value.c_str(), value.size(), &result);
+  return result;
+}
+
+napi_value jsError(napi_env env, const std::string& msg) {
+  napi_value result;
+  napi_create_error(env, NULL, jsString(env, msg), &result);
+  return result;
+}
+
+napi_valuetype typeOf(napi_env env, napi_value value) {
+  napi_valuetype type = napi_undefined;
+  napi_typeof(env, value, &type);
+  return type;
+}
+
+bool isArray(napi_env env, napi_value value) {
+  bool result = false;
+  napi_is_array(env, value, &result);
+  return result;
+}
+
+bool isBuffer(napi_env env, napi_value value) {
+  bool result = false;
+  napi_is_buffer(env, value, &result);
+  return result;
+}
+
+// returns the contents of a typed array of the given type, or NULL
+void* typedArrayData(napi_env env, napi_value value, napi_typedarray_type type, size_t* length) {
+  bool isTypedArray = false;
+  napi_is_typedarray(env, value, &isTypedArray);
+  if (!isTypedArray){
+    return NULL;
+  }
+  napi_typedarray_type actual;
+  void* data = NULL;
+  napi_get_typedarray_info(env, value, &actual, length, &data, NULL, NULL);
+  if (actual != type){
+    return NULL;
+  }
+  // an empty array may have no backing store
+  static double empty;
+  return (data == NULL) ? &empty : data;
+}
+
+double toDouble(napi_env env, napi_value value) {
+  double result = 0;
+  if (napi_get_value_double(env, value, &result) != napi_ok){
+    napi_value number;
+    if (napi_coerce_to_number(env, value, &number) == napi_ok){
+      napi_get_value_double(env, number, &result);
+    }
+  }
+  return result;
+}
+
+uint32_t toUint32(napi_env env, napi_value value) {
+  uint32_t result = 0;
+  if (napi_get_value_uint32(env, value, &result) != napi_ok){
+    napi_value number;
+    if (napi_coerce_to_number(env, value, &number) == napi_ok){
+      napi_get_value_uint32(env, number, &result);
+    }
+  }
+  return result;
+}
+
+bool toBool(napi_env env, napi_value value) {
+  bool result = false;
+  napi_value b;
+  if (napi_coerce_to_bool(env, value, &b) == napi_ok){
+    napi_get_value_bool(env, b, &result);
+  }
+  return result;
+}
+
+std::string toString(napi_env env, napi_value value) {
+  napi_value str;
+  if (napi_coerce_to_string(env, value, &str) != napi_ok){
+    return std::string();
+  }
+  size_t length = 0;
+  napi_get_value_string_utf8(env, str, NULL, 0, &length);
+  std::string result(length, '\0');
+  napi_get_value_string_utf8(env, str, &result[0], length + 1, &length);
+  return result;
+}
+
+napi_value getNamed(napi_env env, napi_value object, const char* name) {
+  napi_value result;
+  if (napi_get_named_property(env, object, name, &result) != napi_ok){
+    return jsUndefined(env);
+  }
+  return result;
+}
+
+void toArray(napi_env env, napi_value input, std::vector<double>& values) {
+  uint32_t numValues = 0;
+  napi_get_array_length(env, input, &numValues);
+  values.reserve(numValues);
+  for (uint32_t i = 0; i < numValues; i++) {
+    napi_value element;
+    napi_get_element(env, input, i, &element);
+    values.push_back(toDouble(env, element));
+  }
+}
+
+// fetches up to SIDX_MAX_ARGS arguments and this, returns the argument count
+size_t getArgs(napi_env env, napi_callback_info info, napi_value* argv, napi_value* self) {
+  size_t argc = SIDX_MAX_ARGS;
+  napi_get_cb_info(env, info, &argc, argv, self, NULL);
+  return (argc > SIDX_MAX_ARGS) ? SIDX_MAX_ARGS : argc;
+}
+
+SpatialIndex* unwrapIndex(napi_env env, napi_value self) {
+  SpatialIndex* index = NULL;
+  napi_unwrap(env, self, reinterpret_cast<void**>(&index));
+  return index;
+}
+
+// takes the calling thread's last libsidx error and clears its error stack
+std::string lastError() {
+  char* pszErrMsg = Error_GetLastErrorMsg();
+  std::string msg = (pszErrMsg == NULL) ? std::string("Unknown error") : std::string(pszErrMsg);
+  free(pszErrMsg);
+  Error_Reset();
+  return msg;
+}
+
+// frees native result buffers once the arrays wrapping them are collected
+void freeData(napi_env env, void* data, void* hint) {
+  free(data);
+}
+
+// holds an index's lock for the scope of a worker's Execute
+class IndexLock {
+public:
+  IndexLock(SharedIndex* idx, bool exclusive) : sidx(idx), exclusive(exclusive) {
+    if (exclusive) {
+      sidx->WriteLock();
+    } else {
+      sidx->ReadLock();
+    }
+  }
+  ~IndexLock() {
+    if (exclusive) {
+      sidx->WriteUnlock();
+    } else {
+      sidx->ReadUnlock();
+    }
+  }
+private:
+  SharedIndex* sidx;
+  bool exclusive;
+};
+
+// records how long the enclosing scope takes in the index's latency histograms
+class OpTimer {
+public:
+  OpTimer(SharedIndex* idx, LatencyOp op) : sidx(idx), op(op), start(std::chrono::steady_clock::now()) {
+  }
+  ~OpTimer() {
+    std::chrono::microseconds elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+    sidx->RecordLatency(op, elapsed.count());
+  }
+private:
+  SharedIndex* sidx;
+  LatencyOp op;
+  std::chrono::steady_clock::time_point start;
+};
+
+// an operation run on the thread pool, Execute runs on the pool and
+// HandleOKCallback back on the main thread inside a handle scope
+class SIDXWorker {
+public:
+  SIDXWorker(napi_env env, napi_value callback, const char* name) : env(env) {
+    napi_value resourceName;
+    napi_value store;
+    napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, &resourceName);
+    napi_create_object(env, &store);
+    napi_create_reference(env, store, 1, &this->persistent);
+    if (callback != NULL){
+      napi_create_reference(env, callback, 1, &this->callback);
+    }
+    napi_create_async_work(env, NULL, resourceName, OnExecute, OnComplete, this, &this->work);
+  }
+  virtual ~SIDXWorker() {
+    // when torn down with the environment, it took the handles with it
+    if (this->env != NULL){
+      napi_delete_async_work(this->env, this->work);
+      if (this->callback != NULL){
+        napi_delete_reference(this->env, this->callback);
+      }
+      napi_delete_reference(this->env, this->persistent);
+    }
+    if (this->pinned != NULL){
+      this->pinned->Unref();
+    }
+  }
+
+  napi_env Env() const { return this->env; }
+
+  // keeps the native index alive until the worker is deleted, whatever becomes
+  // of the SpatialIndex it was queued from
+  void Pin(SharedIndex* shared) {
+    shared->Ref();
+    this->pinned = shared;
+  }
+
+  // main thread, frees a worker whose environment is being torn down before it
+  // completed, without touching JS. A worker still queued on an executor also
+  // gives back its hold on the completion function
+  static void Discard(SIDXWorker* worker, bool queued) {
+    if (queued){
+      napi_release_threadsafe_function(worker->completions, napi_tsfn_release);
+    }
+    worker->env = NULL;
+    delete worker;
+  }
+
+  virtual void Execute() = 0;
+  virtual void HandleOKCallback() = 0;
+  // whether Execute takes the index lock exclusively
+  virtual bool Exclusive() const { return false; }
+
+  // keeps a value alive until the worker completes
+  void SaveToPersistent(const char* key, napi_value value) {
+    napi_value store;
+    napi_get_reference_value(this->env, this->persistent, &store);
+    napi_set_named_property(this->env, store, key, value);
+  }
+
+  napi_value GetFromPersistent(const char* key) {
+    napi_value store;
+    napi_get_reference_value(this->env, this->persistent, &store);
+    return getNamed(this->env, store, key);
+  }
+
+  void Queue() {
+    napi_queue_async_work(this->env, this->work);
+  }
+
+  // main thread, runs the worker on an index's executor instead of the pool
+  void Queue(IndexExecutor* executor) {
+    AddonData* addon = getAddonData(this->env);
+    if (addon->completions == NULL){
+      napi_value resourceName;
+      napi_create_string_utf8(this->env, "sidx:Executor", NAPI_AUTO_LENGTH, &resourceName);
+      napi_create_threadsafe_function(this->env, NULL, NULL, resourceName, 0, 1, NULL, NULL, NULL,
+        OnExecuted, &addon->completions);
+      napi_unref_threadsafe_function(this->env, addon->completions);
+      // added after the function's own hook so it runs first, while completions
+      // can still be posted
+      napi_add_env_cleanup_hook(this->env, IndexExecutor::CancelAll, this->env);
+    }
+    if (addon->pending++ == 0){
+      napi_ref_threadsafe_function(this->env, addon->completions);
+    }
+    // held by the executor thread until the completion is posted
+    napi_acquire_threadsafe_function(addon->completions);
+    this->completions = addon->completions;
+    executor->Submit(this, Exclusive());
+  }
+
+  // executor thread, hands the worker back to the main thread once executed
+  void Executed() {
+    // the worker may be deleted as soon as the call is queued
+    napi_threadsafe_function completions = this->completions;
+    napi_call_threadsafe_function(completions, this, napi_tsfn_nonblocking);
+    napi_release_threadsafe_function(completions, napi_tsfn_release);
+  }
+
+protected:
+  void Call(size_t argc, napi_value* argv) {
+    napi_value cb;
+    napi_value global;
+    napi_value result;
+    napi_get_reference_value(this->env, this->callback, &cb);
+    napi_get_global(this->env, &global);
+    napi_call_function(this->env, global, cb, argc, argv, &result);
+  }
+
+  napi_env env;
+  napi_ref callback = NULL;
+
+private:
+  static void OnExecute(napi_env env, void* data) {
+    static_cast<SIDXWorker*>(data)->Execute();
+  }
+
+  static void OnComplete(napi_env env, napi_status status, void* data) {
+    SIDXWorker* worker = static_cast<SIDXWorker*>(data);
+    if (status != napi_cancelled){
+      napi_handle_scope scope;
+      napi_open_handle_scope(env, &scope);
+      worker->HandleOKCallback();
+      napi_close_handle_scope(env, scope);
+    }
+    delete worker;
+  }
+
+  static void OnExecuted(napi_env env, napi_value jsCallback, void* context, void* data) {
+    if (env == NULL){
+      // the environment is being torn down along with the worker's references
+      Discard(static_cast<SIDXWorker*>(data), false);
+      return;
+    }
+    AddonData* addon = getAddonData(env);
+    if (--addon->pending == 0){
+      napi_unref_threadsafe_function(env, addon->completions);
+    }
+    OnComplete(env, napi_ok, data);
+  }
+
+  napi_ref persistent = NULL;
+  napi_async_work work = NULL;
+  napi_threadsafe_function completions = NULL;
+  SharedIndex* pinned = NULL;
+};
+
+// queues a worker against an index, holding the index object until the
+// worker completes so it can't be collected with the lock held
+void queueIndexWorker(SpatialIndex* index, napi_value holder, SIDXWorker* worker) {
+  worker->SaveToPersistent("index", holder);
+  worker->Pin(index->GetShared());
+  if (index->GetExecutor() != NULL){
+    worker->Queue(index->GetExecutor());
+  } else {
+    worker->Queue();
+  }
+}
+
+// every live executor, so an env's cleanup can find its workers on them
+static std::set<IndexExecutor*> executors;
+static uv_mutex_t executorsMutex;
+static uv_once_t executorsOnce = UV_ONCE_INIT;
+
+static void initExecutorsMutex() {
+  uv_mutex_init(&executorsMutex);
+}
+
+IndexExecutor::IndexExecutor(uint32_t readers) {
+  uv_mutex_init(&mutex);
+  uv_cond_init(&readable);
+  uv_cond_init(&writable);
+  uv_cond_init(&idle);
+  threads.resize(readers + 1);
+  for (uint32_t i = 0; i < readers; i++) {
+    uv_thread_create(&threads[i], ReadLoop, this);
+  }
+  uv_thread_create(&threads[readers], WriteLoop, this);
+  uv_once(&executorsOnce, initExecutorsMutex);
+  uv_mutex_lock(&executorsMutex);
+  executors.insert(this);
+  uv_mutex_unlock(&executorsMutex);
+}
+
+IndexExecutor::~IndexExecutor() {
+  uv_mutex_lock(&executorsMutex);
+  executors.erase(this);
+  uv_mutex_unlock(&executorsMutex);
+  // every queued worker holds a reference on the index that owns the executor,
+  // so by now none are left to drain
+  uv_mutex_lock(&mutex);
+  stopping = true;
+  uv_cond_broadcast(&readable);
+  uv_cond_broadcast(&writable);
+  uv_mutex_unlock(&mutex);
+  for (size_t i = 0; i < threads.size(); i++) {
+    uv_thread_join(&threads[i]);
+  }
+  uv_cond_destroy(&idle);
+  uv_cond_destroy(&writable);
+  uv_cond_destroy(&readable);
+  uv_mutex_destroy(&mutex);
+}
+
+void IndexExecutor::CancelAll(void* arg) {
+  napi_env env = static_cast<napi_env>(arg);
+  std::vector<SIDXWorker*> cancelled;
+  uv_mutex_lock(&executorsMutex);
+  for (std::set<IndexExecutor*>::iterator it = executors.begin(); it != executors.end(); ++it) {
+    (*it)->Cancel(env, cancelled);
+  }
+  uv_mutex_unlock(&executorsMutex);
+  // outside the lock, the last reference on an index deletes its executor
+  for (size_t i = 0; i < cancelled.size(); i++) {
+    SIDXWorker::Discard(cancelled[i], true);
+  }
+}
+
+void IndexExecutor::Cancel(napi_env env, std::vector<SIDXWorker*>& cancelled) {
+  uv_mutex_lock(&mutex);
+  for (std::deque<SIDXWorker*>* queue : { &reads, &writes }) {
+    std::deque<SIDXWorker*>::iterator it = queue->begin();
+    while (it != queue->end()) {
+      if ((*it)->Env() == env) {
+        cancelled.push_back(*it);
+        it = queue->erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  if (writes.empty() && writeDue) {
+    // the queries held back for a cancelled write go ahead
+    writeDue = false;
+    uv_cond_broadcast(&readable);
+  }
+  while (std::find(running.begin(), running.end(), env) != running.end()) {
+    uv_cond_wait(&idle, &mutex);
+  }
+  uv_mutex_unlock(&mutex);
+}
+
+void IndexExecutor::Run(SIDXWorker* worker) {
+  // the worker may be deleted once its completion is posted
+  napi_env env = worker->Env();
+  running.push_back(env);
+  uv_mutex_unlock(&mutex);
+  worker->Execute();
+  worker->Executed();
+  uv_mutex_lock(&mutex);
+  running.erase(std::find(running.begin(), running.end(), env));
+  uv_cond_broadcast(&idle);
+}
+
+void IndexExecutor::Submit(SIDXWorker* worker, bool exclusive) {
+  uv_mutex_lock(&mutex);
+  if (exclusive) {
+    if (writes.empty()) {
+      writeWaitingSince = uv_hrtime();
+      readsPastWrite = 0;
+    }
+    writes.push_back(worker);
+    uv_cond_signal(&writable);
+  } else {
+    reads.push_back(worker);
+    uv_cond_signal(&readable);
+  }
+  uv_mutex_unlock(&mutex);
+}
+
+void IndexExecutor::ReadLoop(void* arg) {
+  IndexExecutor* executor = static_cast<IndexExecutor*>(arg);
+  uv_mutex_lock(&executor->mutex);
+  while (true) {
+    while (!executor->stopping && (executor->reads.empty() || executor->writeDue)) {
+      uv_cond_wait(&executor->readable, &executor->mutex);
+    }
+    if (executor->stopping) {
+      break;
+    }
+    SIDXWorker* worker = executor->reads.front();
+    executor->reads.pop_front();
+    if (!executor->writes.empty() && ++executor->readsPastWrite >= SIDX_WRITE_AFTER_READS) {
+      executor->writeDue = true;
+      uv_cond_signal(&executor->writable);
+    } else if (executor->reads.empty()) {
+      uv_cond_signal(&executor->writable);
+    }
+    executor->Run(worker);
+  }
+  uv_mutex_unlock(&executor->mutex);
+}
+
+void IndexExecutor::WriteLoop(void* arg) {
+  IndexExecutor* executor = static_cast<IndexExecutor*>(arg);
+  uv_mutex_lock(&executor->mutex);
+  const uint64_t deadline = (uint64_t)SIDX_WRITE_AFTER_MS * 1000000;
+  while (true) {
+    // queries first, a write waits until none are queued or it is due
+    while (!executor->stopping) {
+      if (executor->writes.empty()) {
+        uv_cond_wait(&executor->writable, &executor->mutex);
+        continue;
+      }
+      if (executor->reads.empty() || executor->writeDue) {
+        break;
+      }
+      uint64_t waited = uv_hrtime() - executor->writeWaitingSince;
+      if (waited >= deadline) {
+        executor->writeDue = true;
+        break;
+      }
+      uv_cond_timedwait(&executor->writable, &executor->mutex, deadline - waited);
+    }
+    if (executor->stopping) {
+      break;
+    }
+    SIDXWorker* worker = executor->writes.front();
+    executor->writes.pop_front();
+    executor->Run(worker);
+    // the next write waits its own turn behind the queries that were held back
+    executor->writeWaitingSince = uv_hrtime();
+    executor->readsPastWrite = 0;
+    if (executor->writeDue) {
+      executor->writeDue = false;
+      uv_cond_broadcast(&executor->readable);
+    }
+  }
+  uv_mutex_unlock(&executor->mutex);
+}
+
+// items laid out in packed typed arrays, item i owns the coordinates
+// [i * dims, (i + 1) * dims) and the payload bytes [offsets[i], offsets[i + 1])
+struct PackedItems {
+  size_t count = 0;
+  uint32_t dims = 0;
+  const double* fIds = NULL;
+  const int64_t* bIds = NULL;
+  const double* mins = NULL;
+  const double* maxs = NULL;
+  const uint32_t* offsets = NULL;
+  const unsigned char* data = NULL;
+
+  int64_t id(size_t i) const {
+    return (bIds != NULL) ? bIds[i] : static_cast<int64_t>(fIds[i]);
+  }
+};
+
+// the arrays toPackedItems reads in place: ids, mins, maxs, offsets, data
+#define SIDX_PACKED_ARRAYS 5
+
+// validates and unpacks ids, mins, maxs and the optional {offsets, data}
+// payloads, returns an error message or NULL. arrays receives the typed
+// arrays the items point into, see holdPackedArrays
+const char* toPackedItems(napi_env env, napi_value ids, napi_value mins, napi_value maxs,
+    napi_value payloads, uint32_t dims, PackedItems& items, napi_value* arrays) {
+  arrays[0] = ids;
+  arrays[1] = mins;
+  arrays[2] = maxs;
+  arrays[3] = arrays[4] = NULL;
+  size_t minsLength = 0;
+  size_t maxsLength = 0;
+  items.dims = dims;
+  items.bIds = static_cast<const int64_t*>(typedArrayData(env, ids, napi_bigint64_array, &items.count));
+  if (items.bIds == NULL){
+    items.fIds = static_cast<const double*>(typedArrayData(env, ids, napi_float64_array, &items.count));
+  }
+  items.mins = static_cast<const double*>(typedArrayData(env, mins, napi_float64_array, &minsLength));
+  items.maxs = static_cast<const double*>(typedArrayData(env, maxs, napi_float64_array, &maxsLength));
+  if (((items.bIds == NULL) && (items.fIds == NULL)) || (items.mins == NULL) || (items.maxs == NULL)){
+    return "Float64Array or BigInt64Array ids and Float64Array mins and maxs are required";
+  }
+  if ((minsLength != items.count * dims) || (maxsLength != items.count * dims)){
+    return "mins and maxs must hold dimension values per id";
+  }
+
+  napi_valuetype payloadsType = typeOf(env, payloads);
+  if ((payloadsType == napi_undefined) || (payloadsType == napi_null)){
+    return NULL;
+  }
+  if (payloadsType != napi_object){
+    return "payloads must be an object of {offsets, data}";
+  }
+  napi_value offsetsVal = getNamed(env, payloads, "offsets");
+  napi_value dataVal = getNamed(env, payloads, "data");
+  arrays[3] = offsetsVal;
+  arrays[4] = dataVal;
+  size_t offsetsLength = 0;
+  items.offsets = static_cast<const uint32_t*>(typedArrayData(env, offsetsVal, napi_uint32_array, &offsetsLength));
+  if ((items.offsets == NULL) || !isBuffer(env, dataVal)){
+    return "payloads require Uint32Array offsets and a Buffer of data";
+  }
+  void* data = NULL;
+  size_t dataLength = 0;
+  napi_get_buffer_info(env, dataVal, &data, &dataLength);
+  items.data = static_cast<const unsigned char*>(data);
+  if (offsetsLength != items.count + 1){
+    return "payload offsets must hold one more entry than ids";
+  }
+  for (size_t i = 0; i < items.count; i++){
+    if ((items.offsets[i] > items.offsets[i + 1]) || (items.offsets[i + 1] > dataLength)){
+      return "payload offsets must be ascending and within data";
+    }
+  }
+  return NULL;
+}
+
+// holds each array the items point into for the lifetime of the worker, the
+// objects they were read from may drop them while the worker runs
+void holdPackedArrays(SIDXWorker* worker, napi_value* arrays) {
+  static const char* names[SIDX_PACKED_ARRAYS] = {"ids", "mins", "maxs", "offsets", "data"};
+  for (int i = 0; i < SIDX_PACKED_ARRAYS; i++){
+    if (arrays[i] != NULL){
+      worker->SaveToPersistent(names[i], arrays[i]);
+    }
+  }
 }
 
-void toArray(Local<Array>& input, std::vector<double>& values) {
-  unsigned int numValues = input->Length();
-  for (unsigned int i = 0; i < numValues; i++) {
-    values.push_back(input->Get(i)->NumberValue());
+// wraps a malloc'd payload in a Buffer without copying, the buffer frees it
+napi_value toBuffer(napi_env env, char* data, size_t length) {
+  napi_value result;
+  if (length > 0){
+    napi_create_external_buffer(env, length, data, freeData, NULL, &result);
+  } else {
+    free(data);
+    napi_create_buffer(env, 0, NULL, &result);
   }
+  return result;
 }
 
-class SIDXOpenWorker : public Nan::AsyncWorker {
+napi_value toItem(napi_env env, int64_t id, char* data, size_t length) {
+  napi_value obj;
+  napi_create_object(env, &obj);
+  napi_set_named_property(env, obj, "id", jsNumber(env, static_cast<double>(id)));
+  napi_set_named_property(env, obj, "data", toBuffer(env, data, length));
+  return obj;
+}
+
+// builds [{id, data}] from a native result set, ownership of each item's data
+// is transferred to its buffer and the result set is destroyed
+napi_value toItemArray(napi_env env, IndexItemH* items, uint64_t nResults) {
+  napi_value results;
+  napi_create_array_with_length(env, nResults, &results);
+  for(uint64_t i = 0; i < nResults; i++) {
+    unsigned char* pData = NULL;
+    uint64_t len = 0;
+    IndexItemH item = items[i];
+    if (IndexItem_GetData(item, (uint8_t **)&pData, &len) == RT_None)
+    {
+      int64_t id = IndexItem_GetID(item);
+      napi_set_element(env, results, static_cast<uint32_t>(i),
+        toItem(env, id, reinterpret_cast<char*>(pData), len));
+    }
+  }
+  if (nResults > 0){
+    Index_DestroyObjResults(items, nResults);
+  }
+  return results;
+}
+
+// wraps a malloc'd array in a typed array over an external ArrayBuffer,
+// ownership of data is transferred to the array and the pointer is reset
+napi_value toExternalArray(napi_env env, napi_typedarray_type type, void* data, size_t length, size_t size) {
+  napi_value store;
+  napi_value result;
+  if (length > 0){
+    napi_create_external_arraybuffer(env, data, length * size, freeData, NULL, &store);
+  } else {
+    napi_create_arraybuffer(env, 0, NULL, &store);
+  }
+  napi_create_typedarray(env, type, length, store, 0, &result);
+  return result;
+}
+
+// wraps a native id result set in a BigInt64Array without copying, ownership
+// of ids is transferred to the array and the pointer is reset
+napi_value toIdArray(napi_env env, int64_t*& ids, uint64_t nResults) {
+  napi_value result = toExternalArray(env, napi_bigint64_array, ids, nResults, sizeof(int64_t));
+  if (nResults > 0){
+    ids = NULL;
+  }
+  return result;
+}
+
+// position of (x, y) along a Hilbert curve filling a 65536 x 65536 grid
+uint64_t hilbertIndex(uint32_t x, uint32_t y) {
+  const uint32_t n = 1 << 16;
+  uint64_t d = 0;
+  for (uint32_t s = n / 2; s > 0; s /= 2) {
+    uint32_t rx = (x & s) > 0;
+    uint32_t ry = (y & s) > 0;
+    d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
+// orders packed [mins..., maxs...] boxes by the Hilbert index of their centres
+// over the first two axes, so consecutive queries visit neighbouring nodes.
+// Unbounded or NaN boxes have no finite centre and all go in the first cell
+void hilbertOrder(const double* boxes, size_t count, uint32_t dims, std::vector<uint32_t>& order) {
+  order.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    order[i] = i;
+  }
+  if (count < 2) {
+    return;
+  }
+  uint32_t axes = (dims < 2) ? dims : 2;
+  double lo[2] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+  double hi[2] = { -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() };
+  std::vector<double> centres(count * 2, 0);
+  for (size_t i = 0; i < count; i++) {
+    const double* box = boxes + i * 2 * dims;
+    for (uint32_t a = 0; a < axes; a++) {
+      // halved first, so that the sum of two large coordinates cannot overflow
+      double c = box[a] / 2 + box[dims + a] / 2;
+      centres[i * 2 + a] = c;
+      if (std::isfinite(c)) {
+        lo[a] = std::min(lo[a], c);
+        hi[a] = std::max(hi[a], c);
+      }
+    }
+  }
+  std::vector<uint64_t> keys(count);
+  for (size_t i = 0; i < count; i++) {
+    uint32_t cell[2] = { 0, 0 };
+    for (uint32_t a = 0; a < axes; a++) {
+      double c = centres[i * 2 + a];
+      if (hi[a] > lo[a] && std::isfinite(c)) {
+        double f = (c / 2 - lo[a] / 2) / (hi[a] / 2 - lo[a] / 2) * 65535;
+        cell[a] = static_cast<uint32_t>(std::min(std::max(f, 0.0), 65535.0));
+      }
+    }
+    keys[i] = hilbertIndex(cell[0], cell[1]);
+  }
+  std::sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+}
+
+// frees a chunk along with the payloads that never reached a Buffer
+void freeChunk(QueryChunk* chunk) {
+  for (size_t i = 0; i < chunk->size(); i++) {
+    free((*chunk)[i].data);
+  }
+  delete chunk;
+}
+
+// builds [{id, data}] from a query chunk, payloads are handed to the Buffers
+napi_value toChunkArray(napi_env env, QueryChunk* chunk) {
+  napi_value results;
+  napi_create_array_with_length(env, chunk->size(), &results);
+  for (size_t i = 0; i < chunk->size(); i++) {
+    QueryItem& item = (*chunk)[i];
+    napi_set_element(env, results, static_cast<uint32_t>(i),
+      toItem(env, item.id, item.data, item.length));
+    item.data = NULL;
+  }
+  delete chunk;
+  return results;
+}
+
+napi_value toIteratorResult(napi_env env, napi_value value, bool done) {
+  napi_value result;
+  napi_value isDone;
+  napi_create_object(env, &result);
+  napi_get_boolean(env, done, &isDone);
+  napi_set_named_property(env, result, "value", value);
+  napi_set_named_property(env, result, "done", isDone);
+  return result;
+}
+
+class SIDXOpenWorker : public SIDXWorker {
+public:
+  SIDXOpenWorker(napi_env env, napi_value callback, SpatialIndex *idx) : SIDXWorker(env, callback, "sidx:Open") {
+    this->sidx = idx->GetShared();
+  }
+  ~SIDXOpenWorker() {}
+
+  bool Exclusive() const { return true; }
+
+  void Execute() {
+    IndexLock lock(this->sidx, true);
+    if (this->sidx->GetIndex() != NULL){
+      // an attached index may be in use by other threads
+      err = 1;
+      this->errMsg = "Index is already open";
+    } else if (this->sidx->GetProperties() == NULL){
+      // set basic default in-memory r*-tree
+      IndexPropertyH props = IndexProperty_Create();
+      IndexProperty_SetIndexType(props, RT_RTree);
+      IndexProperty_SetIndexStorage(props, RT_Memory);
+      this->sidx->SetProperties(props);
+      this->sidx->SetIndex(Index_Create(props));
+    } else {
+      IndexH idx = Index_Create(sidx->GetProperties());
+      if (idx == NULL){
+        err = 1;
+        this->errMsg = lastError();
+      } else{
+        this->sidx->SetIndex(idx);
+      }
+    }
+    if ((this->err == 0) && (this->sidx->GetIndex() != NULL)){
+      // cache the dimension, the batched calls need it to stride packed coordinates,
+      // and the storage which decides whether the sync calls are allowed
+      IndexPropertyH idxProps = Index_GetProperties(this->sidx->GetIndex());
+      this->sidx->SetDimension(IndexProperty_GetDimension(idxProps));
+      this->sidx->SetType(IndexProperty_GetIndexType(idxProps));
+      this->sidx->SetStorage(IndexProperty_GetIndexStorage(idxProps));
+      IndexProperty_Destroy(idxProps);
+    }
+  }
+
+  void HandleOKCallback() {
+    if (this->err) {
+      std::string msg = "Error opening Index: " + this->errMsg;
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
+    } else {
+      napi_value argv[] = {jsNull(env), jsUndefined(env)};
+      Call(2, argv);
+    }
+  }
+  int err = 0;
+  std::string errMsg;
+  SharedIndex* sidx = NULL;
+};
+
+class SIDXIntersectsWorker : public SIDXWorker {
+public:
+  SIDXIntersectsWorker(napi_env env, napi_value callback, SpatialIndex *idx,
+      double* mins, double* maxs, uint32_t dims, uint32_t offset, uint32_t len) : SIDXWorker(env, callback, "sidx:Intersects") {
+    this->sidx = idx->GetShared();
+    this->mins.assign(mins, mins + dims);
+    this->maxs.assign(maxs, maxs + dims);
+    this->dims = dims;
+    this->offset = offset;
+    this->length = len;
+  }
+  ~SIDXIntersectsWorker() {}
+
+  void Execute() {
+    IndexLock lock(this->sidx, false);
+    OpTimer timer(this->sidx, LatencyIntersects);
+    if (Index_IntersectsPaged_obj(this->sidx->GetIndex(), (double*)&(this->mins[0]), (double*)(&this->maxs[0]),
+                          this->dims, this->offset, this->length, &items, &nResults) != RT_None){
+      errMsg = lastError();
+      err = 1;
+    }
+  }
+
+  void HandleOKCallback() {
+    if (this->err) {
+      std::string msg = "Error performing Intersects: " + this->errMsg;
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
+    } else {
+      napi_value argv[] = {jsNull(env), toItemArray(env, this->items, this->nResults)};
+      Call(2, argv);
+    }
+  }
+
+  int err = 0;
+  std::string errMsg;
+  SharedIndex* sidx = NULL;
+  std::vector<double> mins;
+  std::vector<double> maxs;
+  uint32_t dims = 0;
+  uint32_t offset = 0;
+  uint32_t length = 0;
+  IndexItemH* items = NULL;
+  uint64_t nResults = 0;
+};
+
+class SIDXIntersectsIdsWorker : public SIDXWorker {
+public:
+  SIDXIntersectsIdsWorker(napi_env env, napi_value callback, SpatialIndex *idx,
+      double* mins, double* maxs, uint32_t dims, uint32_t offset, uint32_t len) : SIDXWorker(env, callback, "sidx:IntersectsIds") {
+    this->sidx = idx->GetShared();
+    this->mins.assign(mins, mins + dims);
+    this->maxs.assign(maxs, maxs + dims);
+    this->dims = dims;
+    this->offset = offset;
+    this->length = len;
+  }
+  ~SIDXIntersectsIdsWorker() {
+    // only still set if the ids were never handed over to an array
+    if (this->ids != NULL){
+      Index_Free(this->ids);
+    }
+  }
+
+  void Execute() {
+    IndexLock lock(this->sidx, false);
+    OpTimer timer(this->sidx, LatencyIntersects);
+    if (Index_IntersectsPaged_id(this->sidx->GetIndex(), (double*)&(this->mins[0]), (double*)(&this->maxs[0]),
+                          this->dims, this->offset, this->length, &ids, &nResults) != RT_None){
+      errMsg = lastError();
+      err = 1;
+    }
+  }
+
+  void HandleOKCallback() {
+    if (this->err) {
+      std::string msg = "Error performing Intersects: " + this->errMsg;
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
+    } else {
+      napi_value argv[] = {jsNull(env), toIdArray(env, this->ids, this->nResults)};
+      Call(2, argv);
+    }
+  }
+
+  int err = 0;
+  std::string errMsg;
+  SharedIndex* sidx = NULL;
+  std::vector<double> mins;
+  std::vector<double> maxs;
+  uint32_t dims = 0;
+  uint32_t offset = 0;
+  uint32_t length = 0;
+  int64_t* ids = NULL;
+  uint64_t nResults = 0;
+};
+
+class SIDXNearestWorker : public SIDXWorker {
+public:
+  SIDXNearestWorker(napi_env env, napi_value callback, SpatialIndex *idx, double* point, uint32_t dims,
+      uint32_t k, double maxDistance, bool idsOnly) : SIDXWorker(env, callback, "sidx:Nearest") {
+    this->sidx = idx->GetShared();
+    this->point.assign(point, point + dims);
+    this->dims = dims;
+    this->nResults = k;
+    this->maxDistance = maxDistance;
+    this->idsOnly = idsOnly;
+  }
+  ~SIDXNearestWorker() {
+    if (this->ids != NULL){
+      Index_Free(this->ids);
+    }
+  }
+
+  void Execute() {
+    IndexLock lock(this->sidx, false);
+    OpTimer timer(this->sidx, LatencyNearest);
+    // the query point is a degenerate box, nResults holds k on the way in
+    RTError r;
+    if (this->idsOnly){
+      r = Index_NearestNeighborsWithin_id(this->sidx->GetIndex(), (double*)&(this->point[0]),
+        (double*)&(this->point[0]), this->dims, this->maxDistance, &ids, &nResults);
+    } else {
+      r = Index_NearestNeighborsWithin_obj(this->sidx->GetIndex(), (double*)&(this->point[0]),
+        (double*)&(this->point[0]), this->dims, this->maxDistance, &items, &nResults);
+    }
+    if (r != RT_None){
+      errMsg = lastError();
+      err = 1;
+    }
+  }
+
+  void HandleOKCallback() {
+    if (this->err) {
+      std::string msg = "Error performing Nearest: " + this->errMsg;
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
+    } else {
+      napi_value results;
+      if (this->idsOnly){
+        results = toIdArray(env, this->ids, this->nResults);
+      } else {
+        results = toItemArray(env, this->items, this->nResults);
+      }
+      napi_value argv[] = {jsNull(env), results};
+      Call(2, argv);
+    }
+  }
+
+  int err = 0;
+  std::string errMsg;
+  SharedIndex* sidx = NULL;
+  std::vector<double> point;
+  uint32_t dims = 0;
+  double maxDistance = 0;
+  bool idsOnly = false;
+  int64_t* ids = NULL;
+  IndexItemH* items = NULL;
+  uint64_t nResults = 0;
+};
+
+class SIDXCountWorker : public SIDXWorker {
+public:
+  SIDXCountWorker(napi_env env, napi_value callback, SpatialIndex *idx,
+      double* mins, double* maxs, uint32_t dims) : SIDXWorker(env, callback, "sidx:Count") {
+    this->sidx = idx->GetShared();
+    this->mins.assign(mins, mins + dims);
+    this->maxs.assign(maxs, maxs + dims);
+    this->dims = dims;
+  }
+  ~SIDXCountWorker() {}
+
+  void Execute() {
+    IndexLock lock(this->sidx, false);
+    OpTimer timer(this->sidx, LatencyIntersects);
+    if (Index_Intersects_count(this->sidx->GetIndex(), (double*)&(this->mins[0]), (double*)(&this->maxs[0]),
+                          this->dims, &nResults) != RT_None){
+      errMsg = lastError();
+      err = 1;
+    }
+  }
+
+  void HandleOKCallback() {
+    if (this->err) {
+      std::string msg = "Error performing Count: " + this->errMsg;
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
+    } else {
+      napi_value argv[] = {jsNull(env), jsNumber(env, static_cast<double>(this->nResults))};
+      Call(2, argv);
+    }
+  }
+
+  int err = 0;
+  std::string errMsg;
+  SharedIndex* sidx = NULL;
+  std::vector<double> mins;
+  std::vector<double> maxs;
+  uint32_t dims = 0;
+  uint64_t nResults = 0;
+};
+
+class SIDXCountManyWorker : public SIDXWorker {
 public:
-  SIDXOpenWorker(Nan::Callback *callback, SpatialIndex *idx) : Nan::AsyncWorker(callback) {
-    this->sidx = idx;
+  // boxes are packed as [mins..., maxs...] per box and read in place, the
+  // array is kept alive by a persistent reference
+  SIDXCountManyWorker(napi_env env, napi_value callback, SpatialIndex *idx,
+      const double* boxes, size_t count) : SIDXWorker(env, callback, "sidx:CountMany") {
+    this->sidx = idx->GetShared();
+    this->boxes = boxes;
+    this->count = count;
+    this->counts = static_cast<double*>(malloc(count * sizeof(double)));
+  }
+  ~SIDXCountManyWorker() {
+    if (this->counts != NULL){
+      free(this->counts);
+    }
   }
-  ~SIDXOpenWorker() {}
 
   void Execute() {
-    if (this->sidx->GetProperties() == NULL){
-      // set basic default in-memory r*-tree
-      IndexPropertyH props = IndexProperty_Create();
-      IndexProperty_SetIndexType(props, RT_RTree);
-      IndexProperty_SetIndexStorage(props, RT_Memory);
-      // note we use local properties here as these will be owned
-      // by the index
-      this->sidx->SetIndex(Index_Create(props));
-    } else {
-      IndexH idx = Index_Create(sidx->GetProperties());
-      if (idx == NULL){
+    IndexLock lock(this->sidx, false);
+    uint32_t dims = this->sidx->GetDimension();
+    for (size_t i = 0; i < this->count; i++) {
+      OpTimer timer(this->sidx, LatencyIntersects);
+      double* box = const_cast<double*>(this->boxes + i * 2 * dims);
+      uint64_t nResults = 0;
+      if (Index_Intersects_count(this->sidx->GetIndex(), box, box + dims, dims, &nResults) != RT_None){
+        errMsg = "box " + std::to_string(i) + ": " + lastError();
         err = 1;
-        char* pszErrMsg = Error_GetLastErrorMsg();
-        this->errMsg = std::string(pszErrMsg);
-        free(pszErrMsg);
-      } else{
-        this->sidx->SetIndex(idx);
+        break;
       }
+      // as for count(), a Number holds any count an index can reach exactly
+      this->counts[i] = static_cast<double>(nResults);
     }
   }
 
   void HandleOKCallback() {
-    Nan::HandleScope scope;
     if (this->err) {
-      std::string msg = "Error opening Index: " + this->errMsg;
-      Local<Value> argv[] = {Exception::Error(Nan::New<String>(msg).ToLocalChecked())};
-      callback->Call(1, argv);
+      std::string msg = "Error performing Count: " + this->errMsg;
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
     } else {
-      Local<Value> argv[] = {Nan::Null(),  Nan::Undefined()};
-      callback->Call(2, argv);
+      napi_value results = toExternalArray(env, napi_float64_array, this->counts, this->count, sizeof(double));
+      if (this->count > 0){
+        this->counts = NULL;
+      }
+      napi_value argv[] = {jsNull(env), results};
+      Call(2, argv);
     }
   }
+
   int err = 0;
   std::string errMsg;
-  SpatialIndex* sidx = NULL;
+  SharedIndex* sidx = NULL;
+  const double* boxes = NULL;
+  size_t count = 0;
+  double* counts = NULL;
 };
 
-class SIDXIntersectsWorker : public Nan::AsyncWorker {
+class SIDXIntersectsManyWorker : public SIDXWorker {
 public:
-  SIDXIntersectsWorker(Nan::Callback *callback, SpatialIndex *idx,
-      double* mins, double* maxs, uint32_t dims, uint32_t offset, uint32_t len) : Nan::AsyncWorker(callback) {
-    this->sidx = idx;
-    this->mins.assign(mins, mins + dims);
-    this->maxs.assign(maxs, maxs + dims);
-    this->dims = dims;
-    this->offset = offset;
-    this->length = len;
+  // boxes are packed and held as for SIDXCountManyWorker
+  SIDXIntersectsManyWorker(napi_env env, napi_value callback, SpatialIndex *idx,
+      const double* boxes, size_t count) : SIDXWorker(env, callback, "sidx:IntersectsMany") {
+    this->sidx = idx->GetShared();
+    this->boxes = boxes;
+    this->count = count;
+  }
+  ~SIDXIntersectsManyWorker() {
+    if (this->offsets != NULL){
+      free(this->offsets);
+    }
+    if (this->ids != NULL){
+      free(this->ids);
+    }
   }
-  ~SIDXIntersectsWorker() {}
 
   void Execute() {
-    int64_t l = Index_GetResultSetLimit(this->sidx->GetIndex());
-    int64_t o = Index_GetResultSetOffset(this->sidx->GetIndex());
+    IndexLock lock(this->sidx, false);
+    uint32_t dims = this->sidx->GetDimension();
+    std::vector<uint32_t> order;
+    hilbertOrder(this->boxes, this->count, dims, order);
 
-    if (this->length > 0){
-        Index_SetResultSetLimit(this->sidx->GetIndex(), this->length);
-    }
-    if (this->offset > 0){
-        Index_SetResultSetOffset(this->sidx->GetIndex(), this->offset);
+    // run the boxes in curve order, then lay the runs out in input order
+    std::vector<int64_t> found;
+    std::vector<size_t> starts(this->count);
+    for (size_t k = 0; k < this->count; k++) {
+      OpTimer timer(this->sidx, LatencyIntersects);
+      uint32_t i = order[k];
+      double* box = const_cast<double*>(this->boxes + i * 2 * dims);
+      starts[i] = found.size();
+      if (Index_Intersects_visit(this->sidx->GetIndex(), box, box + dims, dims, collect, &found) != RT_None){
+        errMsg = "box " + std::to_string(i) + ": " + lastError();
+        err = 1;
+        return;
+      }
     }
-    if (Index_Intersects_obj(this->sidx->GetIndex(), (double*)&(this->mins[0]), (double*)(&this->maxs[0]),
-                          this->dims, &items, &nResults) != RT_None){
-      char* pszErrMsg = Error_GetLastErrorMsg();
-      errMsg = std::string(pszErrMsg);
-      free(pszErrMsg);
+    if (found.size() > std::numeric_limits<uint32_t>::max()){
+      errMsg = "too many results for Uint32Array offsets";
       err = 1;
+      return;
+    }
+
+    std::vector<size_t> ends(this->count);
+    for (size_t k = 0; k < this->count; k++) {
+      uint32_t i = order[k];
+      ends[i] = (k + 1 < this->count) ? starts[order[k + 1]] : found.size();
+    }
+    this->nResults = found.size();
+    this->offsets = static_cast<uint32_t*>(malloc((this->count + 1) * sizeof(uint32_t)));
+    this->ids = static_cast<int64_t*>(malloc((this->nResults > 0 ? this->nResults : 1) * sizeof(int64_t)));
+    this->offsets[0] = 0;
+    for (size_t i = 0; i < this->count; i++) {
+      size_t n = ends[i] - starts[i];
+      if (n > 0) {
+        memcpy(this->ids + this->offsets[i], &found[starts[i]], n * sizeof(int64_t));
+      }
+      this->offsets[i + 1] = this->offsets[i] + n;
     }
-    Index_SetResultSetLimit(this->sidx->GetIndex(), l);
-    Index_SetResultSetOffset(this->sidx->GetIndex(), o);
+  }
+
+  static int collect(int64_t id, const uint8_t* pData, uint32_t len, void* pUserData) {
+    static_cast<std::vector<int64_t>*>(pUserData)->push_back(id);
+    return 0;
   }
 
   void HandleOKCallback() {
-    Nan::HandleScope scope;
     if (this->err) {
       std::string msg = "Error performing Intersects: " + this->errMsg;
-      Local<Value> argv[] = {Exception::Error(Nan::New<String>(msg).ToLocalChecked())};
-      callback->Call(1, argv);
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
     } else {
-      v8::Local<v8::Array> results = v8::Local<v8::Array>(Nan::New<v8::Array>());
-      for(uint64_t i = 0; i < nResults; i++) {
-        unsigned char* pData = NULL;
-        uint64_t len = 0;
-        IndexItemH item = items[i];
-        if (IndexItem_GetData(item, (uint8_t **)&pData, &len) == RT_None)
-        {
-          int64_t id = IndexItem_GetID(item);
-          v8::Local<v8::Object> obj = Nan::New<v8::Object>();
-          Nan::Set(obj, Nan::New<v8::String>("id").ToLocalChecked(),
-            Nan::New<Number>(id));
-          // ownership of pData has been transferred to the buffer for management
-          Nan::Set(obj, Nan::New<v8::String>("data").ToLocalChecked(),
-            Nan::NewBuffer(reinterpret_cast<char*>(pData), len).ToLocalChecked());
-          Nan::Set(results, static_cast<uint32_t>(i), obj);
-        } else {
-          char* pszErrMsg = Error_GetLastErrorMsg();
-          this->errMsg = std::string(pszErrMsg);
-          free(pszErrMsg);
-          err = 1;
-        }
-      }
-
-      if (this->nResults > 0){
-        Index_DestroyObjResults(this->items, this->nResults);
-      }
-      Local<Value> argv[] = {Nan::Null(),  results};
-      callback->Call(2, argv);
+      napi_value results;
+      napi_create_object(env, &results);
+      napi_set_named_property(env, results, "offsets",
+        toExternalArray(env, napi_uint32_array, this->offsets, this->count + 1, sizeof(uint32_t)));
+      this->offsets = NULL;
+      napi_set_named_property(env, results, "ids", toIdArray(env, this->ids, this->nResults));
+      napi_value argv[] = {jsNull(env), results};
+      Call(2, argv);
     }
   }
 
   int err = 0;
   std::string errMsg;
-  SpatialIndex* sidx = NULL;
-  std::vector<double> mins;
-  std::vector<double> maxs;
-  uint32_t dims = 0;
-  uint32_t offset = 0;
-  uint32_t length = 0;
-  IndexItemH* items;
-  uint64_t nResults;
+  SharedIndex* sidx = NULL;
+  const double* boxes = NULL;
+  size_t count = 0;
+  uint32_t* offsets = NULL;
+  int64_t* ids = NULL;
+  uint64_t nResults = 0;
 };
 
-class SIDXInsertWorker : public Nan::AsyncWorker {
+class SIDXInsertWorker : public SIDXWorker {
 public:
-  SIDXInsertWorker(Nan::Callback *callback, SpatialIndex *idx, int64_t id,
-      double* mins, double* maxs, uint32_t dims, unsigned char* pData, size_t dataLength) : Nan::AsyncWorker(callback) {
-    this->sidx = idx;
+  SIDXInsertWorker(napi_env env, napi_value callback, SpatialIndex *idx, int64_t id,
+      double* mins, double* maxs, uint32_t dims, unsigned char* pData, size_t dataLength) : SIDXWorker(env, callback, "sidx:Insert") {
+    this->sidx = idx->GetShared();
     this->id = id;
     this->mins.assign(mins, mins + dims);
     this->maxs.assign(maxs, maxs + dims);
@@ -181,30 +1254,31 @@ public:
   ~SIDXInsertWorker() {
   }
 
+  bool Exclusive() const { return true; }
+
   void Execute() {
+    IndexLock lock(this->sidx, true);
+    OpTimer timer(this->sidx, LatencyInsert);
     if (Index_InsertData(this->sidx->GetIndex(), this->id, (double*)&(this->mins[0]), (double*)&(this->maxs[0]),
-        this->dims, (uint8_t *)&(this->data[0]), this->dataLength) != RT_None){
-      char* pszErrMsg = Error_GetLastErrorMsg();
-      errMsg = std::string(pszErrMsg);
-      free(pszErrMsg);
+        this->dims, this->data.empty() ? NULL : (uint8_t *)&(this->data[0]), this->dataLength) != RT_None){
+      errMsg = lastError();
       err = 1;
     }
   }
 
   void HandleOKCallback() {
-    Nan::HandleScope scope;
     if (this->err) {
       std::string msg = "Error inserting data: " + this->errMsg;
-      Local<Value> argv[] = {Exception::Error(Nan::New<String>(msg).ToLocalChecked())};
-      callback->Call(1, argv);
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
     } else {
-      Local<Value> argv[] = {Nan::Null(),  Nan::Undefined()};
-      callback->Call(2, argv);
+      napi_value argv[] = {jsNull(env), jsUndefined(env)};
+      Call(2, argv);
     }
   }
   int err = 0;
   std::string errMsg;
-  SpatialIndex* sidx = NULL;
+  SharedIndex* sidx = NULL;
   int64_t id = 0;
   std::vector<double> mins;
   std::vector<double> maxs;
@@ -213,9 +1287,517 @@ public:
   uint32_t dims = 0;
 };
 
-class SIDXVersionWorker : public Nan::AsyncWorker {
+class SIDXInsertManyWorker : public SIDXWorker {
+public:
+  // the typed arrays are read in place on the worker thread, they are kept alive
+  // by persistent references and must not be modified until the callback fires
+  SIDXInsertManyWorker(napi_env env, napi_value callback, SpatialIndex *idx, const PackedItems& items) : SIDXWorker(env, callback, "sidx:InsertMany") {
+    this->sidx = idx->GetShared();
+    this->items = items;
+  }
+  ~SIDXInsertManyWorker() {
+  }
+
+  bool Exclusive() const { return true; }
+
+  void Execute() {
+    IndexLock lock(this->sidx, true);
+    IndexH handle = this->sidx->GetIndex();
+    uint32_t dims = this->sidx->GetDimension();
+    for (size_t i = 0; i < this->items.count; i++) {
+      OpTimer timer(this->sidx, LatencyInsert);
+      const uint8_t* pData = NULL;
+      size_t dataLength = 0;
+      if (this->items.offsets != NULL) {
+        pData = this->items.data + this->items.offsets[i];
+        dataLength = this->items.offsets[i + 1] - this->items.offsets[i];
+      }
+      if (Index_InsertData(handle, this->items.id(i), const_cast<double*>(this->items.mins + i * dims),
+          const_cast<double*>(this->items.maxs + i * dims), dims, pData, dataLength) != RT_None){
+        errMsg = "item " + std::to_string(i) + ": " + lastError();
+        err = 1;
+        break;
+      }
+    }
+  }
+
+  void HandleOKCallback() {
+    if (this->err) {
+      std::string msg = "Error inserting data: " + this->errMsg;
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
+    } else {
+      napi_value argv[] = {jsNull(env), jsUndefined(env)};
+      Call(2, argv);
+    }
+  }
+  int err = 0;
+  std::string errMsg;
+  SharedIndex* sidx = NULL;
+  PackedItems items;
+};
+
+// fills in the host's L1 data and L2 cache sizes where none are given,
+// falling back to common sizes
+CacheSizes hostCaches(const CacheSizes& given) {
+  CacheSizes caches = given;
+  long size = -1;
+  if (caches.l1 == 0){
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+#endif
+    caches.l1 = (size > 0) ? static_cast<size_t>(size) : 32 * 1024;
+  }
+  size = -1;
+  if (caches.l2 == 0){
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    caches.l2 = (size > 0) ? static_cast<size_t>(size) : 256 * 1024;
+  }
+  return caches;
+}
+
+// bytes a node scan reads per child: the by-dimension low and high
+// coordinates the hit kernels compare against
+size_t scanBytes(uint32_t dims) {
+  return 2 * dims * sizeof(double);
+}
+
+// bytes a memory node keeps resident per child: the scanned coordinates,
+// the child's Region with its own copy of them and its pooled pointer,
+// and the child's id, data pointer and data length
+size_t entryBytes(uint32_t dims) {
+  return 2 * scanBytes(dims) + 96;
+}
+
+// bytes held by the levels above the leaves of a tree packed from count
+// items, every query walks these down to a leaf
+double upperLevelBytes(size_t count, uint32_t leaf, uint32_t node, double fill, uint32_t dims) {
+  double fanout = std::max(node * fill, 2.0);
+  double entries = std::ceil(count / std::max(leaf * fill, 1.0));
+  double bytes = 0;
+  while (entries > 1){
+    bytes += entries * entryBytes(dims);
+    entries = std::ceil(entries / fanout);
+  }
+  return bytes;
+}
+
+const uint32_t capacityCandidates[] = { 16, 32, 64, 128, 256 };
+const size_t nCapacityCandidates = sizeof(capacityCandidates) / sizeof(capacityCandidates[0]);
+
+// the leaf or index capacities worth timing with the other one fixed: those
+// whose node scan fits in L1 and that keep the levels above the leaves of
+// the full tree within L2. Failing that, the one that comes closest
+std::vector<uint32_t> fittingCapacities(size_t count, uint32_t dims, double fill, const CacheSizes& caches,
+    bool leaves, uint32_t other) {
+  std::vector<uint32_t> fitting;
+  uint32_t closest = 0;
+  double closestBytes = std::numeric_limits<double>::max();
+  for (size_t c = 0; c < nCapacityCandidates; c++){
+    uint32_t capacity = capacityCandidates[c];
+    if (capacity * scanBytes(dims) > caches.l1){
+      break;
+    }
+    double upper = leaves ? upperLevelBytes(count, capacity, other, fill, dims) :
+      upperLevelBytes(count, other, capacity, fill, dims);
+    if (upper <= caches.l2){
+      fitting.push_back(capacity);
+    } else if (upper < closestBytes){
+      closest = capacity;
+      closestBytes = upper;
+    }
+  }
+  if (fitting.empty()){
+    fitting.push_back((closest != 0) ? closest : capacityCandidates[0]);
+  }
+  return fitting;
+}
+
+// seconds taken to build a memory r-tree over the sample with the given
+// capacities and count the items within each query box, best of three
+double timeCapacities(IndexPropertyH props, uint32_t leaf, uint32_t node, size_t n, uint32_t dims,
+    const int64_t* ids, const double* mins, const double* maxs, std::vector<double>& queries) {
+  IndexPropertyH trial = IndexProperty_Create();
+  IndexProperty_SetIndexType(trial, RT_RTree);
+  IndexProperty_SetIndexStorage(trial, RT_Memory);
+  IndexProperty_SetDimension(trial, dims);
+  IndexProperty_SetIndexVariant(trial, IndexProperty_GetIndexVariant(props));
+  IndexProperty_SetLeafCapacity(trial, leaf);
+  IndexProperty_SetIndexCapacity(trial, node);
+  IndexH idx = Index_CreateWithArray(trial, n, dims, ids, mins, maxs, NULL, NULL);
+  IndexProperty_Destroy(trial);
+  if (idx == NULL){
+    return std::numeric_limits<double>::max();
+  }
+  double best = std::numeric_limits<double>::max();
+  size_t nQueries = queries.size() / (2 * dims);
+  for (int round = 0; round < 3; round++){
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < nQueries; q++){
+      uint64_t nResults = 0;
+      double* box = &queries[q * 2 * dims];
+      Index_Intersects_count(idx, box, box + dims, dims, &nResults);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  Index_Destroy(idx);
+  return best;
+}
+
+// picks the leaf and index capacities for a bulk load by timing queries on
+// trees built over a sample of the items. The sample's tree is too small to
+// feel the cache, so only capacities that fit the full tree to it are tried,
+// see fittingCapacities
+void autotuneCapacities(IndexPropertyH props, const PackedItems& items, const int64_t* ids,
+    const CacheSizes& given) {
+  const size_t maxSample = 20000;
+  const size_t nQueries = 256;
+  uint32_t dims = items.dims;
+  if (items.count < 1000){
+    return;
+  }
+  size_t step = (items.count + maxSample - 1) / maxSample;
+  size_t n = items.count / step;
+  std::vector<int64_t> sIds(n);
+  std::vector<double> sMins(n * dims);
+  std::vector<double> sMaxs(n * dims);
+  std::vector<double> lo(dims, std::numeric_limits<double>::max());
+  std::vector<double> hi(dims, -std::numeric_limits<double>::max());
+  for (size_t i = 0; i < n; i++){
+    sIds[i] = ids[i * step];
+    for (uint32_t a = 0; a < dims; a++){
+      sMins[i * dims + a] = items.mins[i * step * dims + a];
+      sMaxs[i * dims + a] = items.maxs[i * step * dims + a];
+      lo[a] = std::min(lo[a], sMins[i * dims + a]);
+      hi[a] = std::max(hi[a], sMaxs[i * dims + a]);
+    }
+  }
+  // boxes around sampled items sized to hold a handful of items each if
+  // the data were uniform
+  double scale = std::pow(16.0 / n, 1.0 / dims) / 2;
+  std::vector<double> queries(nQueries * 2 * dims);
+  for (size_t q = 0; q < nQueries; q++){
+    size_t i = (q * n) / nQueries;
+    for (uint32_t a = 0; a < dims; a++){
+      double reach = (hi[a] - lo[a]) * scale;
+      queries[q * 2 * dims + a] = sMins[i * dims + a] - reach;
+      queries[q * 2 * dims + dims + a] = sMaxs[i * dims + a] + reach;
+    }
+  }
+
+  CacheSizes caches = hostCaches(given);
+  double fill = IndexProperty_GetFillFactor(props);
+  uint32_t node = IndexProperty_GetIndexCapacity(props);
+  std::vector<uint32_t> leaves = fittingCapacities(items.count, dims, fill, caches, true, node);
+  double best = std::numeric_limits<double>::max();
+  uint32_t bestLeaf = leaves[0];
+  for (size_t c = 0; c < leaves.size(); c++){
+    double t = timeCapacities(props, leaves[c], node, n, dims, &sIds[0], &sMins[0], &sMaxs[0], queries);
+    if (t < best){
+      best = t;
+      bestLeaf = leaves[c];
+    }
+  }
+  std::vector<uint32_t> nodes = fittingCapacities(items.count, dims, fill, caches, false, bestLeaf);
+  best = std::numeric_limits<double>::max();
+  uint32_t bestNode = nodes[0];
+  for (size_t c = 0; c < nodes.size(); c++){
+    double t = timeCapacities(props, bestLeaf, nodes[c], n, dims, &sIds[0], &sMins[0], &sMaxs[0], queries);
+    if (t < best){
+      best = t;
+      bestNode = nodes[c];
+    }
+  }
+  IndexProperty_SetLeafCapacity(props, bestLeaf);
+  IndexProperty_SetIndexCapacity(props, bestNode);
+}
+
+class SIDXBulkLoadWorker : public SIDXWorker {
+public:
+  // the typed arrays are read in place on the worker thread, see SIDXInsertManyWorker
+  SIDXBulkLoadWorker(napi_env env, napi_value callback, SpatialIndex *idx, const PackedItems& items) : SIDXWorker(env, callback, "sidx:BulkLoad") {
+    this->sidx = idx->GetShared();
+    this->items = items;
+    this->autotune = idx->GetAutotune();
+    this->autotuneCaches = idx->GetAutotuneCaches();
+  }
+  ~SIDXBulkLoadWorker() {
+  }
+
+  bool Exclusive() const { return true; }
+
+  void Execute() {
+    IndexLock lock(this->sidx, true);
+    IndexPropertyH props = this->sidx->GetProperties();
+    if (props == NULL){
+      // same default in-memory r*-tree as open
+      props = IndexProperty_Create();
+      IndexProperty_SetIndexType(props, RT_RTree);
+      IndexProperty_SetIndexStorage(props, RT_Memory);
+      this->sidx->SetProperties(props);
+    }
+    if (IndexProperty_GetIndexType(props) != RT_RTree){
+      // the STR loader only builds r-trees, even for no items
+      this->errMsg = "only rtree indexes can be bulk loaded";
+      err = 1;
+      return;
+    }
+    IndexH idx;
+    if (this->items.count == 0){
+      // the STR loader needs at least one item
+      idx = Index_Create(props);
+    } else {
+      std::vector<int64_t> ids;
+      const int64_t* pIds = this->items.bIds;
+      if (pIds == NULL){
+        ids.resize(this->items.count);
+        for (size_t i = 0; i < this->items.count; i++) {
+          ids[i] = this->items.id(i);
+        }
+        pIds = &ids[0];
+      }
+      if (this->autotune && (IndexProperty_GetIndexType(props) == RT_RTree)){
+        autotuneCapacities(props, this->items, pIds, this->autotuneCaches);
+      }
+      idx = Index_CreateWithArray(props, this->items.count, this->items.dims, pIds,
+        this->items.mins, this->items.maxs, this->items.data, this->items.offsets);
+    }
+    if (idx == NULL){
+      this->errMsg = lastError();
+      err = 1;
+    } else {
+      this->sidx->SetIndex(idx);
+      this->sidx->SetDimension(this->items.dims);
+      this->sidx->SetType(IndexProperty_GetIndexType(props));
+      this->sidx->SetStorage(IndexProperty_GetIndexStorage(props));
+    }
+  }
+
+  void HandleOKCallback() {
+    if (this->err) {
+      std::string msg = "Error bulk loading Index: " + this->errMsg;
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
+    } else {
+      napi_value argv[] = {jsNull(env), GetFromPersistent("index")};
+      Call(2, argv);
+    }
+  }
+  int err = 0;
+  std::string errMsg;
+  SharedIndex* sidx = NULL;
+  PackedItems items;
+  bool autotune = false;
+  CacheSizes autotuneCaches;
+};
+
+enum TemporalOp {
+  TemporalInsert,
+  TemporalDelete,
+  TemporalIntersects
+};
+
+// inserts, deletes and intersects against an mvrtree when there are no
+// velocities, or a tprtree when vmins and vmaxs are given
+class SIDXTemporalWorker : public SIDXWorker {
+public:
+  SIDXTemporalWorker(napi_env env, napi_value callback, SpatialIndex *idx, TemporalOp op, int64_t id,
+      const std::vector<double>& mins, const std::vector<double>& maxs,
+      const std::vector<double>& vmins, const std::vector<double>& vmaxs,
+      double tStart, double tEnd, unsigned char* pData, size_t dataLength) : SIDXWorker(env, callback, "sidx:Temporal") {
+    this->sidx = idx->GetShared();
+    this->op = op;
+    this->id = id;
+    this->mins = mins;
+    this->maxs = maxs;
+    this->vmins = vmins;
+    this->vmaxs = vmaxs;
+    this->dims = mins.size();
+    this->tStart = tStart;
+    this->tEnd = tEnd;
+    this->data.assign(pData, pData + dataLength);
+  }
+  ~SIDXTemporalWorker() {}
+
+  bool Exclusive() const { return this->op != TemporalIntersects; }
+
+  void Execute() {
+    IndexLock lock(this->sidx, Exclusive());
+    OpTimer timer(this->sidx, (this->op == TemporalInsert) ? LatencyInsert :
+      (this->op == TemporalDelete) ? LatencyDelete : LatencyIntersects);
+    IndexH handle = this->sidx->GetIndex();
+    double* pMins = &this->mins[0];
+    double* pMaxs = &this->maxs[0];
+    const uint8_t* pData = this->data.empty() ? NULL : &this->data[0];
+    RTError r = RT_None;
+    if (this->vmins.empty()){
+      switch (this->op) {
+        case TemporalInsert:
+          r = Index_InsertMVRData(handle, this->id, pMins, pMaxs, this->tStart, this->tEnd, this->dims,
+            pData, this->data.size());
+          break;
+        case TemporalDelete:
+          r = Index_DeleteMVRData(handle, this->id, pMins, pMaxs, this->tStart, this->tEnd, this->dims);
+          break;
+        case TemporalIntersects:
+          r = Index_MVRIntersects_obj(handle, pMins, pMaxs, this->tStart, this->tEnd, this->dims,
+            &this->items, &this->nResults);
+          break;
+      }
+    } else {
+      double* pVMins = &this->vmins[0];
+      double* pVMaxs = &this->vmaxs[0];
+      switch (this->op) {
+        case TemporalInsert:
+          r = Index_InsertTPData(handle, this->id, pMins, pMaxs, pVMins, pVMaxs, this->tStart, this->tEnd,
+            this->dims, pData, this->data.size());
+          break;
+        case TemporalDelete:
+          r = Index_DeleteTPData(handle, this->id, pMins, pMaxs, pVMins, pVMaxs, this->tStart, this->tEnd,
+            this->dims);
+          break;
+        case TemporalIntersects:
+          r = Index_TPIntersects_obj(handle, pMins, pMaxs, pVMins, pVMaxs, this->tStart, this->tEnd,
+            this->dims, &this->items, &this->nResults);
+          break;
+      }
+    }
+    if (r != RT_None){
+      errMsg = lastError();
+      err = 1;
+    }
+  }
+
+  void HandleOKCallback() {
+    if (this->err) {
+      std::string msg;
+      switch (this->op) {
+        case TemporalInsert:
+          msg = "Error inserting data: ";
+          break;
+        case TemporalDelete:
+          msg = "Error deleting data: ";
+          break;
+        case TemporalIntersects:
+          msg = "Error performing Intersects: ";
+          break;
+      }
+      napi_value argv[] = {jsError(env, msg + this->errMsg)};
+      Call(1, argv);
+    } else if (this->op == TemporalIntersects) {
+      napi_value argv[] = {jsNull(env), toItemArray(env, this->items, this->nResults)};
+      Call(2, argv);
+    } else {
+      napi_value argv[] = {jsNull(env), jsUndefined(env)};
+      Call(2, argv);
+    }
+  }
+
+  int err = 0;
+  std::string errMsg;
+  SharedIndex* sidx = NULL;
+  TemporalOp op;
+  int64_t id = 0;
+  std::vector<double> mins;
+  std::vector<double> maxs;
+  std::vector<double> vmins;
+  std::vector<double> vmaxs;
+  uint32_t dims = 0;
+  double tStart = 0;
+  double tEnd = 0;
+  std::vector<unsigned char> data;
+  IndexItemH* items = NULL;
+  uint64_t nResults = 0;
+};
+
+class SIDXQueryWorker : public SIDXWorker {
+public:
+  // no callback, results and errors are delivered through the cursor
+  SIDXQueryWorker(napi_env env, QueryCursor *cursor, SpatialIndex *idx, const std::vector<double>& mins,
+      const std::vector<double>& maxs, uint32_t chunkSize, IndexPositionH position, size_t maxChunks)
+      : SIDXWorker(env, NULL, "sidx:Query") {
+    this->cursor = cursor;
+    this->sidx = idx->GetShared();
+    this->mins = mins;
+    this->maxs = maxs;
+    this->chunkSize = chunkSize;
+    this->position = position;
+    this->maxChunks = maxChunks;
+  }
+  ~SIDXQueryWorker() {
+    while (!this->fetched.empty()) {
+      freeChunk(this->fetched.front());
+      this->fetched.pop_front();
+    }
+  }
+
+  void Execute() {
+    IndexLock lock(this->sidx, false);
+    this->chunk = new QueryChunk();
+    this->chunk->reserve(this->chunkSize);
+    if (Index_Intersects_resume(this->sidx->GetIndex(), (double*)&(this->mins[0]), (double*)(&this->maxs[0]),
+                          this->mins.size(), this->position, visit, this) != RT_None){
+      errMsg = lastError();
+      err = 1;
+    }
+    if ((this->chunk != NULL) && !this->chunk->empty() && !err) {
+      this->fetched.push_back(this->chunk);
+    } else if (this->chunk != NULL) {
+      freeChunk(this->chunk);
+    }
+    this->chunk = NULL;
+  }
+
+  static int visit(int64_t id, const uint8_t* pData, uint32_t len, void* pUserData) {
+    SIDXQueryWorker* worker = static_cast<SIDXQueryWorker*>(pUserData);
+    QueryItem item = { id, static_cast<char*>(malloc(len)), len };
+    if (len > 0) {
+      memcpy(item.data, pData, len);
+    }
+    worker->chunk->push_back(item);
+    if (worker->chunk->size() < worker->chunkSize) {
+      return 0;
+    }
+    worker->fetched.push_back(worker->chunk);
+    if (worker->fetched.size() == worker->maxChunks) {
+      // the next worker resumes from here
+      worker->chunk = NULL;
+      worker->more = true;
+      return 1;
+    }
+    worker->chunk = new QueryChunk();
+    worker->chunk->reserve(worker->chunkSize);
+    return 0;
+  }
+
+  void HandleOKCallback() {
+    std::string msg;
+    if (this->err) {
+      msg = "Error performing Query: " + this->errMsg;
+    }
+    this->cursor->Fetched(env, GetFromPersistent("cursor"), this->fetched, !this->more || this->err, msg);
+  }
+
+  int err = 0;
+  std::string errMsg;
+  QueryCursor* cursor = NULL;
+  SharedIndex* sidx = NULL;
+  std::vector<double> mins;
+  std::vector<double> maxs;
+  uint32_t chunkSize = 0;
+  IndexPositionH position = NULL;
+  size_t maxChunks = 0;
+  bool more = false;
+  QueryChunk* chunk = NULL;
+  std::deque<QueryChunk*> fetched;
+};
+
+class SIDXVersionWorker : public SIDXWorker {
 public:
-  SIDXVersionWorker(Nan::Callback *callback) : Nan::AsyncWorker(callback) {
+  SIDXVersionWorker(napi_env env, napi_value callback) : SIDXWorker(env, callback, "sidx:Version") {
   }
   ~SIDXVersionWorker() {}
 
@@ -226,25 +1808,25 @@ public:
   }
 
   void HandleOKCallback() {
-    Nan::HandleScope scope;
-    Local<Value> argv[] = {Nan::Null(),  Nan::New<String>(this->version).ToLocalChecked()};
-    callback->Call(2, argv);
+    napi_value argv[] = {jsNull(env), jsString(env, this->version)};
+    Call(2, argv);
   }
   std::string version;
 };
 
-class SIDXBoundsWorker : public Nan::AsyncWorker {
+class SIDXBoundsWorker : public SIDXWorker {
 public:
-  SIDXBoundsWorker(Nan::Callback *callback, SpatialIndex *idx) : Nan::AsyncWorker(callback) {
-    this->sidx = idx;
+  SIDXBoundsWorker(napi_env env, napi_value callback, SpatialIndex *idx) : SIDXWorker(env, callback, "sidx:Bounds") {
+    this->sidx = idx->GetShared();
   }
   ~SIDXBoundsWorker() {
   }
 
   void Execute() {
+    IndexLock lock(this->sidx, false);
     uint32_t dims;
-    double* pMins;
-    double* pMaxs;
+    double* pMins = NULL;
+    double* pMaxs = NULL;
     if (Index_GetBounds(this->sidx->GetIndex(), &pMins, &pMaxs, &dims) == RT_None){
       this->mins.assign(pMins, pMins + dims);
       this->maxs.assign(pMaxs, pMaxs + dims);
@@ -252,42 +1834,180 @@ public:
       free(pMins);
       free(pMaxs);
     } else {
-      char* pszErrMsg = Error_GetLastErrorMsg();
-      errMsg = std::string(pszErrMsg);
-      free(pszErrMsg);
+      errMsg = lastError();
       this->err = 1;
     }
   }
 
   void HandleOKCallback() {
-    Nan::HandleScope scope;
     if (this->err) {
       std::string msg = "Error gettings bounds: " + this->errMsg;
-      Local<Value> argv[] = {Exception::Error(Nan::New<String>(msg).ToLocalChecked())};
-      callback->Call(1, argv);
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
     } else {
-      v8::Local<v8::Array> results = v8::Local<v8::Array>(Nan::New<v8::Array>());
-      for(uint64_t i = 0; i < this->dims; i++) {
-        Nan::Set(results, static_cast<uint32_t>(i), Nan::New<v8::Number>(this->mins[i]));
-        Nan::Set(results, static_cast<uint32_t>(dims + i), Nan::New<v8::Number>(this->maxs[i]));
+      napi_value results;
+      napi_create_array_with_length(env, 2 * this->dims, &results);
+      for(uint32_t i = 0; i < this->dims; i++) {
+        napi_set_element(env, results, i, jsNumber(env, this->mins[i]));
+        napi_set_element(env, results, this->dims + i, jsNumber(env, this->maxs[i]));
       }
-      Local<Value> argv[] = {Nan::Null(),  results};
-      callback->Call(2, argv);
+      napi_value argv[] = {jsNull(env), results};
+      Call(2, argv);
     }
   }
   int err = 0;
   std::string errMsg;
-  SpatialIndex* sidx = NULL;
+  SharedIndex* sidx = NULL;
   std::vector<double> mins;
   std::vector<double> maxs;
   uint32_t dims = 0;
 };
 
-class SIDXDeleteWorker : public Nan::AsyncWorker {
+class SIDXStatsWorker : public SIDXWorker {
+public:
+  SIDXStatsWorker(napi_env env, napi_value callback, SpatialIndex *idx) : SIDXWorker(env, callback, "sidx:Stats") {
+    this->sidx = idx->GetShared();
+  }
+  ~SIDXStatsWorker() {
+    if (this->nodesInLevel != NULL){
+      Index_Free(this->nodesInLevel);
+    }
+  }
+
+  void Execute() {
+    IndexLock lock(this->sidx, false);
+    if (Index_GetStatistics(this->sidx->GetIndex(), &this->stats, &this->nodesInLevel, &this->nLevels) != RT_None){
+      errMsg = lastError();
+      err = 1;
+    }
+  }
+
+  void HandleOKCallback() {
+    if (this->err) {
+      std::string msg = "Error getting statistics: " + this->errMsg;
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
+      return;
+    }
+    napi_value results;
+    napi_value levels;
+    napi_value latency;
+    napi_create_object(env, &results);
+    napi_set_named_property(env, results, "reads", jsNumber(env, this->stats.nReads));
+    napi_set_named_property(env, results, "writes", jsNumber(env, this->stats.nWrites));
+    napi_set_named_property(env, results, "splits", jsNumber(env, this->stats.nSplits));
+    napi_set_named_property(env, results, "hits", jsNumber(env, this->stats.nHits));
+    napi_set_named_property(env, results, "misses", jsNumber(env, this->stats.nMisses));
+    napi_set_named_property(env, results, "adjustments", jsNumber(env, this->stats.nAdjustments));
+    napi_set_named_property(env, results, "queryResults", jsNumber(env, this->stats.nQueryResults));
+    napi_set_named_property(env, results, "bufferHits", jsNumber(env, this->stats.nBufferHits));
+    napi_set_named_property(env, results, "nodes", jsNumber(env, this->stats.nNodes));
+    napi_set_named_property(env, results, "data", jsNumber(env, this->stats.nData));
+    napi_set_named_property(env, results, "treeHeight", jsNumber(env, this->stats.nTreeHeight));
+    napi_create_array_with_length(env, this->nLevels, &levels);
+    for (uint32_t l = 0; l < this->nLevels; l++) {
+      napi_set_element(env, levels, l, jsNumber(env, this->nodesInLevel[l]));
+    }
+    napi_set_named_property(env, results, "nodesInLevel", levels);
+
+    const char* names[LatencyOps] = { "insert", "delete", "intersects", "nearest" };
+    napi_create_object(env, &latency);
+    for (int op = 0; op < LatencyOps; op++) {
+      const LatencyHistogram& histogram = this->sidx->GetLatency(static_cast<LatencyOp>(op));
+      napi_value entry;
+      napi_value buckets;
+      uint64_t count = 0;
+      napi_create_object(env, &entry);
+      napi_create_array_with_length(env, LatencyHistogram::buckets, &buckets);
+      for (int i = 0; i < LatencyHistogram::buckets; i++) {
+        uint64_t n = histogram.counts[i].load();
+        count += n;
+        napi_set_element(env, buckets, i, jsNumber(env, n));
+      }
+      napi_set_named_property(env, entry, "count", jsNumber(env, count));
+      napi_set_named_property(env, entry, "totalMicros", jsNumber(env, histogram.totalMicros.load()));
+      napi_set_named_property(env, entry, "buckets", buckets);
+      napi_set_named_property(env, latency, names[op], entry);
+    }
+    napi_set_named_property(env, results, "latency", latency);
+
+    napi_value argv[] = {jsNull(env), results};
+    Call(2, argv);
+  }
+  int err = 0;
+  std::string errMsg;
+  SharedIndex* sidx = NULL;
+  IndexStatistics stats;
+  uint32_t* nodesInLevel = NULL;
+  uint32_t nLevels = 0;
+};
+
+enum StorageOp {
+  StorageFlush,
+  StorageClearBuffer,
+  StorageClose
+};
+
+// writes out or drops the buffered pages, or closes the index, holding the
+// index exclusively so the I/O happens here rather than on a later query or GC
+class SIDXStorageWorker : public SIDXWorker {
+public:
+  SIDXStorageWorker(napi_env env, napi_value callback, SpatialIndex *idx, StorageOp op) : SIDXWorker(env, callback, "sidx:Storage") {
+    this->sidx = idx->GetShared();
+    this->op = op;
+  }
+  ~SIDXStorageWorker() {}
+
+  bool Exclusive() const { return true; }
+
+  void Execute() {
+    IndexLock lock(this->sidx, true);
+    IndexH handle = this->sidx->GetIndex();
+    if (handle == NULL){
+      // closed by another wrapper while this was queued
+      errMsg = "Index must be open";
+      err = 1;
+      return;
+    }
+    // the flush calls report failures on the error stack only
+    int nErrors = Error_GetErrorCount();
+    if (this->op == StorageClearBuffer){
+      Index_ClearBuffer(handle);
+    } else {
+      Index_Flush(handle);
+    }
+    if (Error_GetErrorCount() > nErrors){
+      errMsg = lastError();
+      err = 1;
+    } else if (this->op == StorageClose){
+      // a failed flush leaves the index open so nothing is silently lost
+      Index_Destroy(handle);
+      this->sidx->SetIndex(NULL);
+    }
+  }
+
+  void HandleOKCallback() {
+    if (this->err) {
+      const char* names[] = { "flushing", "clearing buffer", "closing" };
+      std::string msg = std::string("Error ") + names[this->op] + ": " + this->errMsg;
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
+    } else {
+      napi_value argv[] = {jsNull(env), jsUndefined(env)};
+      Call(2, argv);
+    }
+  }
+  int err = 0;
+  std::string errMsg;
+  SharedIndex* sidx = NULL;
+  StorageOp op;
+};
+
+class SIDXDeleteWorker : public SIDXWorker {
 public:
-  SIDXDeleteWorker(Nan::Callback *callback, SpatialIndex *idx, int64_t id,
-      double* mins, double* maxs, uint32_t dims) : Nan::AsyncWorker(callback) {
-    this->sidx = idx;
+  SIDXDeleteWorker(napi_env env, napi_value callback, SpatialIndex *idx, int64_t id,
+      double* mins, double* maxs, uint32_t dims) : SIDXWorker(env, callback, "sidx:Delete") {
+    this->sidx = idx->GetShared();
     this->id = id;
     this->mins.assign(mins, mins + dims);
     this->maxs.assign(maxs, maxs + dims);
@@ -296,108 +2016,219 @@ public:
   ~SIDXDeleteWorker() {
   }
 
+  bool Exclusive() const { return true; }
+
   void Execute() {
+    IndexLock lock(this->sidx, true);
+    OpTimer timer(this->sidx, LatencyDelete);
     if (Index_DeleteData(this->sidx->GetIndex(), this->id, (double*)&(this->mins[0]), (double*)&(this->maxs[0]),
         this->dims) != RT_None){
-      char* pszErrMsg = Error_GetLastErrorMsg();
-      errMsg = std::string(pszErrMsg);
-      free(pszErrMsg);
+      errMsg = lastError();
       err = 1;
     }
   }
 
   void HandleOKCallback() {
-    Nan::HandleScope scope;
     if (this->err) {
       std::string msg = "Error deleting data: " + this->errMsg;
-      Local<Value> argv[] = {Exception::Error(Nan::New<String>(msg).ToLocalChecked())};
-      callback->Call(1, argv);
+      napi_value argv[] = {jsError(env, msg)};
+      Call(1, argv);
     } else {
-      Local<Value> argv[] = {Nan::Null(),  Nan::Undefined()};
-      callback->Call(2, argv);
+      napi_value argv[] = {jsNull(env), jsUndefined(env)};
+      Call(2, argv);
     }
   }
   int err = 0;
   std::string errMsg;
-  SpatialIndex* sidx = NULL;
+  SharedIndex* sidx = NULL;
   int64_t id = 0;
   std::vector<double> mins;
   std::vector<double> maxs;
   uint32_t dims = 0;
 };
 
-SpatialIndex::SpatialIndex(){
+SharedIndex::SharedIndex() {
+#ifdef __GLIBC__
+  // glibc's default rwlock keeps letting readers in ahead of a waiting
+  // writer, so a steady stream of queries would starve the writes
+  pthread_rwlockattr_t attr;
+  pthread_rwlockattr_init(&attr);
+  pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&lock, &attr);
+  pthread_rwlockattr_destroy(&attr);
+#else
+  uv_rwlock_init(&lock);
+#endif
 }
 
-SpatialIndex::~SpatialIndex() {
+SharedIndex::~SharedIndex() {
+  // idle, queued workers hold their index object and so a reference
+  delete executor;
+  uv_rwlock_destroy(&lock);
   if (handle != NULL) {
     Index_Destroy(handle);
     handle = NULL;
   }
-  else if (props != NULL) {
-    // props were created but handle wasn't which can happen if open fails
+  if (props != NULL) {
+    // the index keeps its own copy of the properties
     IndexProperty_Destroy (props);
     props = NULL;
   }
 }
 
-void SpatialIndex::Init(v8::Local<v8::Object> exports) {
-  Nan::HandleScope scope;
+// indexes handed out by share() and not yet attached, each token owns a reference
+static std::map<uint32_t, SharedIndex*> sharedTokens;
+static uint32_t nextToken = 1;
+static uv_mutex_t sharedMutex;
+static uv_once_t sharedOnce = UV_ONCE_INIT;
+
+static void initSharedMutex() {
+  uv_mutex_init(&sharedMutex);
+}
+
+SpatialIndex::SpatialIndex(SharedIndex* shared) : shared(shared) {
+}
+
+SpatialIndex::~SpatialIndex() {
+  shared->Unref();
+}
+
+void SpatialIndex::Destructor(napi_env env, void* data, void* hint) {
+  delete static_cast<SpatialIndex*>(data);
+}
+
+void deleteAddonData(napi_env env, void* data, void* hint) {
+  AddonData* addon = static_cast<AddonData*>(data);
+  napi_delete_reference(env, addon->indexConstructor);
+  napi_delete_reference(env, addon->cursorConstructor);
+  delete addon;
+}
+
+AddonData* getAddonData(napi_env env) {
+  AddonData* addon = NULL;
+  napi_get_instance_data(env, reinterpret_cast<void**>(&addon));
+  return addon;
+}
+
+#define SIDX_METHOD(name, fn) { name, NULL, fn, NULL, NULL, NULL, napi_default, NULL }
+
+napi_value SpatialIndex::Init(napi_env env, napi_value exports) {
+  napi_property_descriptor properties[] = {
+    { "bulkLoad", NULL, BulkLoad, NULL, NULL, NULL, napi_static, NULL },
+    { "attach", NULL, Attach, NULL, NULL, NULL, napi_static, NULL },
+    SIDX_METHOD("open", Open),
+    SIDX_METHOD("share", Share),
+    SIDX_METHOD("version", Version),
+    SIDX_METHOD("dimension", Dimension),
+    SIDX_METHOD("insert", InsertData),
+    SIDX_METHOD("insertMany", InsertMany),
+    SIDX_METHOD("delete", DeleteData),
+    SIDX_METHOD("intersects", Intersects),
+    SIDX_METHOD("intersectsIds", IntersectsIds),
+    SIDX_METHOD("intersectsMany", IntersectsMany),
+    SIDX_METHOD("nearest", Nearest),
+    SIDX_METHOD("nearestIds", NearestIds),
+    SIDX_METHOD("count", Count),
+    SIDX_METHOD("countMany", CountMany),
+    SIDX_METHOD("bounds", Bounds),
+    SIDX_METHOD("stats", Stats),
+    SIDX_METHOD("flush", Flush),
+    SIDX_METHOD("clearBuffer", ClearBuffer),
+    SIDX_METHOD("close", Close),
+    SIDX_METHOD("query", Query),
+    SIDX_METHOD("intersectsSync", IntersectsSync),
+    SIDX_METHOD("nearestSync", NearestSync),
+    SIDX_METHOD("countSync", CountSync),
+    SIDX_METHOD("insertTimed", InsertTimed),
+    SIDX_METHOD("deleteTimed", DeleteTimed),
+    SIDX_METHOD("intersectsTimed", IntersectsTimed),
+    SIDX_METHOD("insertMoving", InsertMoving),
+    SIDX_METHOD("deleteMoving", DeleteMoving),
+    SIDX_METHOD("intersectsMoving", IntersectsMoving)
+  };
+  napi_value cons;
+  napi_define_class(env, "SpatialIndex", NAPI_AUTO_LENGTH, New, NULL,
+    sizeof(properties) / sizeof(properties[0]), properties, &cons);
 
-  // Prepare constructor template
-  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
-  tpl->SetClassName(Nan::New("SpatialIndex").ToLocalChecked());
-  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  AddonData* addon = new AddonData();
+  napi_create_reference(env, cons, 1, &addon->indexConstructor);
+  napi_create_reference(env, QueryCursor::Init(env), 1, &addon->cursorConstructor);
+  napi_set_instance_data(env, addon, deleteAddonData, NULL);
 
-  // Prototype
-  Nan::SetPrototypeMethod(tpl, "open", Open);
-  Nan::SetPrototypeMethod(tpl, "version", Version);
-  Nan::SetPrototypeMethod(tpl, "dimension", Dimension);
-  Nan::SetPrototypeMethod(tpl, "insert", InsertData);
-  Nan::SetPrototypeMethod(tpl, "delete", DeleteData);
-  Nan::SetPrototypeMethod(tpl, "intersects", Intersects);
-  Nan::SetPrototypeMethod(tpl, "bounds", Bounds);
-  constructor.Reset(tpl->GetFunction());
-  exports->Set(Nan::New("SpatialIndex").ToLocalChecked(), tpl->GetFunction());
+  napi_set_named_property(env, exports, "SpatialIndex", cons);
+  return exports;
 }
 
-void SpatialIndex::New(const Nan::FunctionCallbackInfo<v8::Value>& info) {
-  if (info.IsConstructCall()) {
+napi_value SpatialIndex::New(napi_env env, napi_callback_info info) {
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  napi_value params = (argc > 0) ? argv[0] : jsUndefined(env);
+  napi_value newTarget;
+  napi_get_new_target(env, info, &newTarget);
+
+  if (newTarget != NULL) {
     // Invoked as constructor: `new SpatialIndex(...)`
-    Handle<Array> propertyNames;
     IndexPropertyH props = NULL;
-    v8::Local<v8::Value> params = info[0];
+    bool autotune = false;
+    CacheSizes autotuneCaches;
+    uint32_t threads = 0;
+
+    if (typeOf(env, params) == napi_external) {
+      // from attach(), wraps an index shared by another thread and takes
+      // over the token's reference. Any other external is someone else's
+      void* shared = NULL;
+      napi_get_value_external(env, params, &shared);
+      AddonData* addon = getAddonData(env);
+      if (shared == NULL || shared != addon->attaching) {
+        napi_throw_error(env, NULL, "SpatialIndex options must be an object");
+        return NULL;
+      }
+      addon->attaching = NULL;
+      SpatialIndex* obj = new SpatialIndex(static_cast<SharedIndex*>(shared));
+      napi_wrap(env, self, obj, Destructor, NULL, NULL);
+      return self;
+    }
 
-    if (params->IsObject()) {
-      Handle<Object> jsParam;
-      int i, n = 0;
+    if (typeOf(env, params) == napi_object) {
+      napi_value propertyNames;
+      uint32_t i, n = 0;
       props = IndexProperty_Create();
-      jsParam = Handle<Object>::Cast(params);
-      propertyNames = jsParam->GetPropertyNames();
-      n = propertyNames->Length();
+      // libspatialindex defaults to disk, the documented default is memory
+      IndexProperty_SetIndexStorage(props, RT_Memory);
+      napi_get_property_names(env, params, &propertyNames);
+      napi_get_array_length(env, propertyNames, &n);
       for (i = 0; i < n ; i++) {
-        Handle<Value> b = propertyNames->Get(Nan::New<Integer>(i));
-        const char* k = std::string(*String::Utf8Value(b)).c_str();
-        const char* v = std::string(*String::Utf8Value(jsParam->Get(b))).c_str();
-        switch (hash(k)) {
+        napi_value b;
+        napi_value value;
+        napi_get_element(env, propertyNames, i, &b);
+        napi_get_property(env, params, b, &value);
+        std::string k = toString(env, b);
+        std::string v = toString(env, value);
+        RTError r = RT_None;
+        switch (hash(k.c_str())) {
           case  hash("type"):
-            switch(hash(v)) {
+            switch(hash(v.c_str())) {
               case hash ("rtree"):
                 IndexProperty_SetIndexType(props, RT_RTree);
                 break;
+              case hash ("mvrtree"):
+                IndexProperty_SetIndexType(props, RT_MVRTree);
+                break;
+              case hash ("tprtree"):
+                IndexProperty_SetIndexType(props, RT_TPRTree);
+                break;
               default:
                 break;
             }
             break;
           case  hash("storage"):
-            switch(hash(v)){
+            switch(hash(v.c_str())){
               case hash("memory"):
                 IndexProperty_SetIndexStorage(props, RT_Memory);
                 break;
               case hash("disk"): {
-                Local<String> s = Nan::Get(jsParam, Nan::New<String>("filename").ToLocalChecked()).ToLocalChecked()->ToString();
-                Nan::Utf8String val(s);
-                std::string fname(*val);
+                std::string fname = toString(env, getNamed(env, params, "filename"));
                 IndexProperty_SetFileName(props, fname.c_str());
                 IndexProperty_SetIndexStorage(props, RT_Disk);
                 break;
@@ -407,7 +2238,7 @@ void SpatialIndex::New(const Nan::FunctionCallbackInfo<v8::Value>& info) {
             }
             break;
           case hash("variant"):
-            switch(hash(v)){
+            switch(hash(v.c_str())){
               case hash("rstar"):
                 IndexProperty_SetIndexVariant(props, RT_Star);
                 break;
@@ -421,8 +2252,93 @@ void SpatialIndex::New(const Nan::FunctionCallbackInfo<v8::Value>& info) {
                 break;
             }
             break;
+          case hash("horizon"):
+            r = IndexProperty_SetTPRHorizon(props, toDouble(env, value));
+            break;
+          case hash("pageSize"):
+            r = IndexProperty_SetPagesize(props, toUint32(env, value));
+            break;
+          case hash("indexCapacity"):
+            r = IndexProperty_SetIndexCapacity(props, toUint32(env, value));
+            break;
+          case hash("leafCapacity"):
+            r = IndexProperty_SetLeafCapacity(props, toUint32(env, value));
+            break;
+          case hash("indexPoolCapacity"):
+            r = IndexProperty_SetIndexPoolCapacity(props, toUint32(env, value));
+            break;
+          case hash("leafPoolCapacity"):
+            r = IndexProperty_SetLeafPoolCapacity(props, toUint32(env, value));
+            break;
+          case hash("regionPoolCapacity"):
+            r = IndexProperty_SetRegionPoolCapacity(props, toUint32(env, value));
+            break;
+          case hash("pointPoolCapacity"):
+            r = IndexProperty_SetPointPoolCapacity(props, toUint32(env, value));
+            break;
+          case hash("bufferingCapacity"):
+            r = IndexProperty_SetBufferingCapacity(props, toUint32(env, value));
+            break;
+          case hash("writeThrough"):
+            r = IndexProperty_SetWriteThrough(props, toBool(env, value));
+            break;
+          case hash("indexId"):
+            r = IndexProperty_SetIndexID(props, static_cast<int64_t>(toDouble(env, value)));
+            break;
+          case hash("overwrite"):
+            r = IndexProperty_SetOverwrite(props, toBool(env, value));
+            break;
+          case hash("tightMBRs"):
+            r = IndexProperty_SetEnsureTightMBRs(props, toBool(env, value));
+            break;
+          case hash("nearMinimumOverlapFactor"):
+            r = IndexProperty_SetNearMinimumOverlapFactor(props, toUint32(env, value));
+            break;
+          case hash("fillFactor"):
+            r = IndexProperty_SetFillFactor(props, toDouble(env, value));
+            break;
+          case hash("splitDistributionFactor"):
+            r = IndexProperty_SetSplitDistributionFactor(props, toDouble(env, value));
+            break;
+          case hash("reinsertFactor"):
+            r = IndexProperty_SetReinsertFactor(props, toDouble(env, value));
+            break;
+          case hash("autotune"):
+            if (typeOf(env, value) == napi_object) {
+              // cache sizes to tune for in place of the host's
+              const char* levels[] = {"l1", "l2"};
+              size_t* sizes[] = {&autotuneCaches.l1, &autotuneCaches.l2};
+              for (int l = 0; l < 2; l++) {
+                napi_value size = getNamed(env, value, levels[l]);
+                if (typeOf(env, size) == napi_undefined) {
+                  continue;
+                }
+                double bytes = toDouble(env, size);
+                if (!(bytes >= 1) || (bytes != static_cast<size_t>(bytes))) {
+                  IndexProperty_Destroy(props);
+                  napi_throw_error(env, NULL, "Invalid option autotune: l1 and l2 must be cache sizes in bytes");
+                  return NULL;
+                }
+                *sizes[l] = static_cast<size_t>(bytes);
+              }
+              autotune = true;
+            } else {
+              autotune = toBool(env, value);
+            }
+            break;
+          case hash("threads"): {
+            double n = toDouble(env, value);
+            if ((n < 0) || (n > SIDX_MAX_THREADS) || (n != static_cast<uint32_t>(n))){
+              std::string msg = "Invalid option threads: must be an integer from 0 to " + std::to_string(SIDX_MAX_THREADS);
+              IndexProperty_Destroy(props);
+              napi_throw_error(env, NULL, msg.c_str());
+              return NULL;
+            }
+            threads = static_cast<uint32_t>(n);
+            break;
+          }
           case hash("dimension"):
-            switch(hash(v)){
+            switch(hash(v.c_str())){
                 case hash("2"):
                   IndexProperty_SetDimension(props, 2);
                   break;
@@ -435,181 +2351,972 @@ void SpatialIndex::New(const Nan::FunctionCallbackInfo<v8::Value>& info) {
           default:
             break;
         };
+        if (r != RT_None){
+          std::string msg = "Invalid option " + k + ": " + lastError();
+          IndexProperty_Destroy(props);
+          napi_throw_error(env, NULL, msg.c_str());
+          return NULL;
+        }
       }
     }
-    SpatialIndex* obj = new SpatialIndex();
-    obj->props = props;
-    obj->Wrap(info.This());
-    info.GetReturnValue().Set(info.This());
+    SpatialIndex* obj = new SpatialIndex(new SharedIndex());
+    obj->SetProperties(props);
+    obj->SetAutotune(autotune, autotuneCaches);
+    if (threads > 0){
+      obj->SetExecutor(new IndexExecutor(threads));
+    }
+    napi_wrap(env, self, obj, Destructor, NULL, NULL);
+    return self;
   } else {
     // Invoked as plain function `SpatialIndex(...)`, turn into construct call.
-    const int argc = 1;
-    v8::Local<v8::Value> argv[argc] = { info[0] };
-    v8::Local<v8::Function> cons = Nan::New<v8::Function>(constructor);
-    info.GetReturnValue().Set(cons->NewInstance(argc, argv));
+    napi_value cons;
+    napi_value instance;
+    napi_get_reference_value(env, getAddonData(env)->indexConstructor, &cons);
+    napi_new_instance(env, cons, 1, &params, &instance);
+    return instance;
   }
 }
 
-void SpatialIndex::Open(const Nan::FunctionCallbackInfo<v8::Value>& info) {
-  if (info.Length() == 1){
-    Nan::HandleScope scope;
-    SpatialIndex* index = ObjectWrap::Unwrap<SpatialIndex>(info.Holder());
-    Nan::Callback *callback = new Nan::Callback(info[0].As<Function>());
-    AsyncQueueWorker(new SIDXOpenWorker(callback, index));
+napi_value SpatialIndex::Open(napi_env env, napi_callback_info info) {
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  if (argc == 1){
+    SpatialIndex* index = unwrapIndex(env, self);
+    queueIndexWorker(index, self, new SIDXOpenWorker(env, argv[0], index));
   } else {
-    Nan::ThrowError("Open requires a callback function");
+    napi_throw_error(env, NULL, "Open requires a callback function");
   }
+  return NULL;
 }
 
-void SpatialIndex::Version(const Nan::FunctionCallbackInfo<v8::Value>& info) {
-  if (info.Length() == 1){
-    Nan::Callback *callback = new Nan::Callback(info[0].As<Function>());
-    AsyncQueueWorker(new SIDXVersionWorker(callback));
-  } else {
-    Nan::ThrowError("Version requires a callback function");
+napi_value SpatialIndex::BulkLoad(napi_env env, napi_callback_info info) {
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  // options, {ids, mins, maxs, payloads}, cb
+  if ((argc != 3) || (typeOf(env, argv[1]) != napi_object)){
+    napi_throw_error(env, NULL, "BulkLoad requires options, an object of {ids, mins, maxs, payloads} and a callback function");
+    return NULL;
+  }
+  napi_value cons;
+  napi_value instance;
+  napi_get_reference_value(env, getAddonData(env)->indexConstructor, &cons);
+  if (napi_new_instance(env, cons, 1, &argv[0], &instance) != napi_ok){
+    return NULL;
+  }
+  SpatialIndex* index = unwrapIndex(env, instance);
+  uint32_t dims = (index->GetProperties() == NULL) ? 2 : IndexProperty_GetDimension(index->GetProperties());
+
+  napi_value data = argv[1];
+  PackedItems items;
+  napi_value arrays[SIDX_PACKED_ARRAYS];
+  const char* pszErr = toPackedItems(env, getNamed(env, data, "ids"), getNamed(env, data, "mins"),
+    getNamed(env, data, "maxs"), getNamed(env, data, "payloads"), dims, items, arrays);
+  if (pszErr != NULL){
+    napi_throw_error(env, NULL, pszErr);
+    return NULL;
+  }
+
+  SIDXBulkLoadWorker* worker = new SIDXBulkLoadWorker(env, argv[2], index, items);
+  holdPackedArrays(worker, arrays);
+  queueIndexWorker(index, instance, worker);
+  return NULL;
+}
+
+napi_value SpatialIndex::Share(napi_env env, napi_callback_info info) {
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+    return NULL;
+  }
+  // the token holds a reference until it is attached
+  index->shared->Ref();
+  uv_once(&sharedOnce, initSharedMutex);
+  uv_mutex_lock(&sharedMutex);
+  uint32_t token = nextToken++;
+  sharedTokens[token] = index->shared;
+  uv_mutex_unlock(&sharedMutex);
+
+  napi_value result;
+  napi_create_uint32(env, token, &result);
+  return result;
+}
+
+napi_value SpatialIndex::Attach(napi_env env, napi_callback_info info) {
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  if ((argc != 1) || (typeOf(env, argv[0]) != napi_number)){
+    napi_throw_error(env, NULL, "Attach requires a token from share()");
+    return NULL;
+  }
+  uint32_t token = toUint32(env, argv[0]);
+  SharedIndex* shared = NULL;
+  uv_once(&sharedOnce, initSharedMutex);
+  uv_mutex_lock(&sharedMutex);
+  std::map<uint32_t, SharedIndex*>::iterator it = sharedTokens.find(token);
+  if (it != sharedTokens.end()){
+    shared = it->second;
+    sharedTokens.erase(it);
+  }
+  uv_mutex_unlock(&sharedMutex);
+  if (shared == NULL){
+    napi_throw_error(env, NULL, "Unknown or already attached index token");
+    return NULL;
+  }
+
+  AddonData* addon = getAddonData(env);
+  napi_value cons;
+  napi_value external;
+  napi_value instance;
+  napi_get_reference_value(env, addon->indexConstructor, &cons);
+  napi_create_external(env, shared, NULL, NULL, &external);
+  addon->attaching = shared;
+  napi_status status = napi_new_instance(env, cons, 1, &external, &instance);
+  addon->attaching = NULL;
+  if (status != napi_ok){
+    shared->Unref();
+    return NULL;
   }
+  return instance;
 }
 
-void SpatialIndex::Dimension(const Nan::FunctionCallbackInfo<v8::Value>& info){
-  SpatialIndex* index = ObjectWrap::Unwrap<SpatialIndex>(info.Holder());
-  if (index->handle == NULL){
-    Nan::ThrowError("Index must be open");
+napi_value SpatialIndex::Version(napi_env env, napi_callback_info info) {
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  if (argc == 1){
+    (new SIDXVersionWorker(env, argv[0]))->Queue();
   } else {
-    IndexPropertyH props = Index_GetProperties(index->handle);
-    uint32_t dim = IndexProperty_GetDimension(props);
-    info.GetReturnValue().Set(Nan::New<Uint32>(dim));
+    napi_throw_error(env, NULL, "Version requires a callback function");
+  }
+  return NULL;
+}
+
+napi_value SpatialIndex::Dimension(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+    return NULL;
   }
+  napi_value result;
+  napi_create_uint32(env, index->GetDimension(), &result);
+  return result;
 }
 
-void SpatialIndex::InsertData(const Nan::FunctionCallbackInfo<v8::Value>& info){
-  SpatialIndex* index = ObjectWrap::Unwrap<SpatialIndex>(info.Holder());
-  if (index->handle == NULL){
-    Nan::ThrowError("Index must be open");
+napi_value SpatialIndex::InsertData(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
   } else {
     // id, mins, maxs, data, cb, data is optional
-    if ((info.Length() == 4) || (info.Length() == 5)){
-      if ((info[0]->IsNumber()) && (info[1]->IsArray()) && (info[2]->IsArray())){
+    if ((argc == 4) || (argc == 5)){
+      if ((typeOf(env, argv[0]) == napi_number) && isArray(env, argv[1]) && isArray(env, argv[2])){
         int64_t id = 0;
         uint32_t dims = 0;
         unsigned char* pData = NULL;
         size_t dataLen = 0;
         std::vector<double> mins;
         std::vector<double> maxs;
-        Nan::Callback *callback;
-
-        if (info.Length() == 4){
-          callback = new Nan::Callback(info[3].As<Function>());
-        } else {
-          callback = new Nan::Callback(info[4].As<Function>());
-          Local<Object> bufferObj = info[3]->ToObject();
-          pData = reinterpret_cast<unsigned char*>(Buffer::Data(bufferObj));
-          dataLen = Buffer::Length(bufferObj);
+
+        if ((argc == 5) && isBuffer(env, argv[3])){
+          napi_get_buffer_info(env, argv[3], reinterpret_cast<void**>(&pData), &dataLen);
         }
 
-        id = info[0]->NumberValue();
-        Local<Array> in1 = Local<Array>::Cast(info[1]);
-        Local<Array> in2 = Local<Array>::Cast(info[2]);
-        toArray(in1, mins);
-        toArray(in2, maxs);
+        id = static_cast<int64_t>(toDouble(env, argv[0]));
+        toArray(env, argv[1], mins);
+        toArray(env, argv[2], maxs);
         dims = mins.size();
 
-        Nan::HandleScope scope;
-        SpatialIndex* index = ObjectWrap::Unwrap<SpatialIndex>(info.Holder());
-        AsyncQueueWorker(new SIDXInsertWorker(callback, index, id,
+        queueIndexWorker(index, self, new SIDXInsertWorker(env, argv[argc - 1], index, id,
           (double*)&mins[0], (double*)&maxs[0], dims, pData, dataLen));
       } else {
-        Nan::ThrowError("Insert requires numeric id, min and max MBR arrays");
+        napi_throw_error(env, NULL, "Insert requires numeric id, min and max MBR arrays");
       }
     } else {
-      Nan::ThrowError("Insert requires numeric id, min and max");
+      napi_throw_error(env, NULL, "Insert requires numeric id, min and max");
     }
   }
+  return NULL;
+}
+
+napi_value SpatialIndex::InsertMany(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+    return NULL;
+  }
+  // ids, mins, maxs, cb
+  // ids, mins, maxs, payloads, cb, payloads is {offsets: Uint32Array, data: Buffer}
+  if ((argc != 4) && (argc != 5)){
+    napi_throw_error(env, NULL, "InsertMany requires ids, mins and maxs typed arrays, payloads are optional");
+    return NULL;
+  }
+  PackedItems items;
+  napi_value arrays[SIDX_PACKED_ARRAYS];
+  napi_value payloads = (argc == 5) ? argv[3] : jsUndefined(env);
+  const char* pszErr = toPackedItems(env, argv[0], argv[1], argv[2], payloads, index->GetDimension(), items, arrays);
+  if (pszErr != NULL){
+    napi_throw_error(env, NULL, pszErr);
+    return NULL;
+  }
+
+  SIDXInsertManyWorker* worker = new SIDXInsertManyWorker(env, argv[argc - 1], index, items);
+  holdPackedArrays(worker, arrays);
+  queueIndexWorker(index, self, worker);
+  return NULL;
 }
 
-void SpatialIndex::DeleteData(const Nan::FunctionCallbackInfo<v8::Value>& info){
-  SpatialIndex* index = ObjectWrap::Unwrap<SpatialIndex>(info.Holder());
-  if (index->handle == NULL){
-    Nan::ThrowError("Index must be open");
+napi_value SpatialIndex::DeleteData(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
   } else {
     // id, mins, maxs, cb
-    if ((info.Length() == 4) ){
-      if ((info[0]->IsNumber()) && (info[1]->IsArray()) && (info[2]->IsArray())){
+    if (argc == 4){
+      if ((typeOf(env, argv[0]) == napi_number) && isArray(env, argv[1]) && isArray(env, argv[2])){
         int64_t id = 0;
         uint32_t dims = 0;
         std::vector<double> mins;
         std::vector<double> maxs;
-        Nan::Callback *callback = new Nan::Callback(info[3].As<Function>());
 
-        id = info[0]->NumberValue();
-        Local<Array> in1 = Local<Array>::Cast(info[1]);
-        Local<Array> in2 = Local<Array>::Cast(info[2]);
-        toArray(in1, mins);
-        toArray(in2, maxs);
+        id = static_cast<int64_t>(toDouble(env, argv[0]));
+        toArray(env, argv[1], mins);
+        toArray(env, argv[2], maxs);
         dims = mins.size();
 
-        AsyncQueueWorker(new SIDXDeleteWorker(callback, index, id,
+        queueIndexWorker(index, self, new SIDXDeleteWorker(env, argv[3], index, id,
           (double*)&mins[0], (double*)&maxs[0], dims));
       } else {
-        Nan::ThrowError("Insert requires numeric id, min and max MBR arrays");
+        napi_throw_error(env, NULL, "Insert requires numeric id, min and max MBR arrays");
       }
     } else {
-      Nan::ThrowError("Insert requires numeric id, min and max");
+      napi_throw_error(env, NULL, "Insert requires numeric id, min and max");
     }
   }
+  return NULL;
 }
 
-void SpatialIndex::Intersects(const Nan::FunctionCallbackInfo<v8::Value>& info){
-  SpatialIndex* index = ObjectWrap::Unwrap<SpatialIndex>(info.Holder());
-  if (index->handle == NULL){
-    Nan::ThrowError("Index must be open");
+napi_value SpatialIndex::Intersects(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
   } else {
     // mins, maxs, cb
     // mins, maxs, offset, length, cb
-    if ((info.Length() == 3) || (info.Length() == 5)){
-      Nan::Callback *callback;
+    if ((argc == 3) || (argc == 5)){
       uint32_t offset = 0;
       uint32_t length = 0;
-      if (info.Length() == 3){
-        callback = new Nan::Callback(info[2].As<Function>());
+      if (argc == 5){
+        offset = toUint32(env, argv[2]);
+        length = toUint32(env, argv[3]);
+      }
+      if (isArray(env, argv[0]) && isArray(env, argv[1])){
+        uint32_t dims = 0;
+        std::vector<double> mins;
+        std::vector<double> maxs;
+
+        toArray(env, argv[0], mins);
+        toArray(env, argv[1], maxs);
+        dims = mins.size();
+
+        queueIndexWorker(index, self, new SIDXIntersectsWorker(env, argv[argc - 1], index,
+          (double*)&mins[0], (double*)&maxs[0], dims, offset, length));
       } else {
-        callback = new Nan::Callback(info[4].As<Function>());
-        offset = info[2]->Uint32Value();
-        length = info[3]->Uint32Value();
+        napi_throw_error(env, NULL, "Intersect requires min and max MBR arrays, offset and length are optional");
+      }
+    } else {
+      napi_throw_error(env, NULL, "Intersect requires min and max MBR arrays offset and length are optional");
+    }
+  }
+  return NULL;
+}
+
+napi_value SpatialIndex::IntersectsIds(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+  } else {
+    // mins, maxs, cb
+    // mins, maxs, offset, length, cb
+    if ((argc == 3) || (argc == 5)){
+      uint32_t offset = 0;
+      uint32_t length = 0;
+      if (argc == 5){
+        offset = toUint32(env, argv[2]);
+        length = toUint32(env, argv[3]);
       }
-      if ((info[0]->IsArray()) && (info[1]->IsArray())){
+      if (isArray(env, argv[0]) && isArray(env, argv[1])){
         uint32_t dims = 0;
         std::vector<double> mins;
         std::vector<double> maxs;
 
-        Local<Array> in1 = Local<Array>::Cast(info[0]);
-        Local<Array> in2 = Local<Array>::Cast(info[1]);
-        toArray(in1, mins);
-        toArray(in2, maxs);
+        toArray(env, argv[0], mins);
+        toArray(env, argv[1], maxs);
         dims = mins.size();
 
-        Nan::HandleScope scope;
-        SpatialIndex* index = ObjectWrap::Unwrap<SpatialIndex>(info.Holder());
-        AsyncQueueWorker(new SIDXIntersectsWorker(callback, index,
+        queueIndexWorker(index, self, new SIDXIntersectsIdsWorker(env, argv[argc - 1], index,
           (double*)&mins[0], (double*)&maxs[0], dims, offset, length));
       } else {
-        Nan::ThrowError("Intersect requires min and max MBR arrays, offset and length are optional");
+        napi_throw_error(env, NULL, "IntersectsIds requires min and max MBR arrays, offset and length are optional");
+      }
+    } else {
+      napi_throw_error(env, NULL, "IntersectsIds requires min and max MBR arrays offset and length are optional");
+    }
+  }
+  return NULL;
+}
+
+napi_value queueNearest(napi_env env, napi_callback_info info, bool idsOnly){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+  } else {
+    // point, k, cb
+    // point, k, maxDistance, cb
+    if (((argc == 3) || (argc == 4)) && isArray(env, argv[0]) && (typeOf(env, argv[1]) == napi_number)){
+      double maxDistance = std::numeric_limits<double>::infinity();
+      std::vector<double> point;
+      if (argc == 4){
+        maxDistance = toDouble(env, argv[2]);
+      }
+
+      toArray(env, argv[0], point);
+
+      queueIndexWorker(index, self, new SIDXNearestWorker(env, argv[argc - 1], index, (double*)&point[0], point.size(),
+        toUint32(env, argv[1]), maxDistance, idsOnly));
+    } else {
+      napi_throw_error(env, NULL, "Nearest requires a point array and k, maxDistance is optional");
+    }
+  }
+  return NULL;
+}
+
+napi_value SpatialIndex::Nearest(napi_env env, napi_callback_info info){
+  return queueNearest(env, info, false);
+}
+
+napi_value SpatialIndex::NearestIds(napi_env env, napi_callback_info info){
+  return queueNearest(env, info, true);
+}
+
+// parses [id], mins, maxs, [vmins, vmaxs], tStart, tEnd, [data], cb for the
+// timed (mvrtree) and moving (tprtree) methods
+napi_value queueTemporal(napi_env env, napi_callback_info info, TemporalOp op, bool moving, const char* name){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  std::string method(name);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+    return NULL;
+  }
+  if (index->GetType() != (moving ? RT_TPRTree : RT_MVRTree)){
+    method += moving ? " requires a tprtree index" : " requires an mvrtree index";
+    napi_throw_error(env, NULL, method.c_str());
+    return NULL;
+  }
+  size_t first = (op == TemporalIntersects) ? 0 : 1;
+  size_t arrays = moving ? 4 : 2;
+  size_t required = first + arrays + 3;
+  bool withData = (op == TemporalInsert) && (argc == required + 1);
+  bool valid = (argc == required) || withData;
+  if (valid && (first == 1)){
+    valid = typeOf(env, argv[0]) == napi_number;
+  }
+  for (size_t i = first; valid && (i < first + arrays); i++){
+    valid = isArray(env, argv[i]);
+  }
+  for (size_t i = first + arrays; valid && (i < first + arrays + 2); i++){
+    valid = typeOf(env, argv[i]) == napi_number;
+  }
+  if (!valid){
+    method += (op == TemporalIntersects) ? " requires min and max MBR arrays" : " requires numeric id, min and max MBR arrays";
+    method += moving ? ", velocity min and max arrays" : "";
+    method += (op == TemporalInsert) ? " and a time interval, data is optional" : " and a time interval";
+    napi_throw_error(env, NULL, method.c_str());
+    return NULL;
+  }
+
+  std::vector<double> mins;
+  std::vector<double> maxs;
+  std::vector<double> vmins;
+  std::vector<double> vmaxs;
+  toArray(env, argv[first], mins);
+  toArray(env, argv[first + 1], maxs);
+  if (moving){
+    toArray(env, argv[first + 2], vmins);
+    toArray(env, argv[first + 3], vmaxs);
+  }
+  if ((mins.size() != index->GetDimension()) || (maxs.size() != mins.size()) ||
+      (moving && ((vmins.size() != mins.size()) || (vmaxs.size() != mins.size())))){
+    method += " requires arrays of the index dimension";
+    napi_throw_error(env, NULL, method.c_str());
+    return NULL;
+  }
+  int64_t id = (first == 1) ? static_cast<int64_t>(toDouble(env, argv[0])) : 0;
+  double tStart = toDouble(env, argv[first + arrays]);
+  double tEnd = toDouble(env, argv[first + arrays + 1]);
+  unsigned char* pData = NULL;
+  size_t dataLen = 0;
+  if (withData && isBuffer(env, argv[argc - 2])){
+    napi_get_buffer_info(env, argv[argc - 2], reinterpret_cast<void**>(&pData), &dataLen);
+  }
+
+  queueIndexWorker(index, self, new SIDXTemporalWorker(env, argv[argc - 1], index, op, id, mins, maxs,
+    vmins, vmaxs, tStart, tEnd, pData, dataLen));
+  return NULL;
+}
+
+napi_value SpatialIndex::InsertTimed(napi_env env, napi_callback_info info){
+  return queueTemporal(env, info, TemporalInsert, false, "InsertTimed");
+}
+
+napi_value SpatialIndex::DeleteTimed(napi_env env, napi_callback_info info){
+  return queueTemporal(env, info, TemporalDelete, false, "DeleteTimed");
+}
+
+napi_value SpatialIndex::IntersectsTimed(napi_env env, napi_callback_info info){
+  return queueTemporal(env, info, TemporalIntersects, false, "IntersectsTimed");
+}
+
+napi_value SpatialIndex::InsertMoving(napi_env env, napi_callback_info info){
+  return queueTemporal(env, info, TemporalInsert, true, "InsertMoving");
+}
+
+napi_value SpatialIndex::DeleteMoving(napi_env env, napi_callback_info info){
+  return queueTemporal(env, info, TemporalDelete, true, "DeleteMoving");
+}
+
+napi_value SpatialIndex::IntersectsMoving(napi_env env, napi_callback_info info){
+  return queueTemporal(env, info, TemporalIntersects, true, "IntersectsMoving");
+}
+
+napi_value SpatialIndex::Count(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+  } else {
+    // mins, maxs, cb
+    if ((argc == 3) && isArray(env, argv[0]) && isArray(env, argv[1])){
+      std::vector<double> mins;
+      std::vector<double> maxs;
+
+      toArray(env, argv[0], mins);
+      toArray(env, argv[1], maxs);
+
+      queueIndexWorker(index, self, new SIDXCountWorker(env, argv[2], index,
+        (double*)&mins[0], (double*)&maxs[0], mins.size()));
+    } else {
+      napi_throw_error(env, NULL, "Count requires min and max MBR arrays");
+    }
+  }
+  return NULL;
+}
+
+napi_value SpatialIndex::CountMany(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+  } else {
+    // boxes, cb
+    size_t length = 0;
+    const double* boxes = (argc == 2) ?
+      static_cast<const double*>(typedArrayData(env, argv[0], napi_float64_array, &length)) : NULL;
+    if (boxes != NULL){
+      uint32_t dims = index->GetDimension();
+      if (length % (2 * dims) != 0){
+        napi_throw_error(env, NULL, "CountMany requires boxes to hold min and max values per box");
+        return NULL;
+      }
+      SIDXCountManyWorker* worker = new SIDXCountManyWorker(env, argv[1], index, boxes, length / (2 * dims));
+      worker->SaveToPersistent("boxes", argv[0]);
+      queueIndexWorker(index, self, worker);
+    } else {
+      napi_throw_error(env, NULL, "CountMany requires a Float64Array of boxes");
+    }
+  }
+  return NULL;
+}
+
+napi_value SpatialIndex::IntersectsMany(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+  } else {
+    // boxes, cb
+    size_t length = 0;
+    const double* boxes = (argc == 2) ?
+      static_cast<const double*>(typedArrayData(env, argv[0], napi_float64_array, &length)) : NULL;
+    if (boxes != NULL){
+      uint32_t dims = index->GetDimension();
+      if (length % (2 * dims) != 0){
+        napi_throw_error(env, NULL, "IntersectsMany requires boxes to hold min and max values per box");
+        return NULL;
       }
+      SIDXIntersectsManyWorker* worker = new SIDXIntersectsManyWorker(env, argv[1], index, boxes, length / (2 * dims));
+      worker->SaveToPersistent("boxes", argv[0]);
+      queueIndexWorker(index, self, worker);
+    } else {
+      napi_throw_error(env, NULL, "IntersectsMany requires a Float64Array of boxes");
+    }
+  }
+  return NULL;
+}
+
+napi_value SpatialIndex::Bounds(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  if (argc == 1){
+    SpatialIndex* index = unwrapIndex(env, self);
+    if (index->GetIndex() == NULL){
+      napi_throw_error(env, NULL, "Index must be open");
+    } else {
+      queueIndexWorker(index, self, new SIDXBoundsWorker(env, argv[0], index));
+    }
+  } else{
+    napi_throw_error(env, NULL, "Bounds requires a callback function");
+  }
+  return NULL;
+}
+
+napi_value SpatialIndex::Stats(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  if (argc == 1){
+    SpatialIndex* index = unwrapIndex(env, self);
+    if (index->GetIndex() == NULL){
+      napi_throw_error(env, NULL, "Index must be open");
     } else {
-      Nan::ThrowError("Intersect requires min and max MBR arrays offset and length are optional");
+      queueIndexWorker(index, self, new SIDXStatsWorker(env, argv[0], index));
     }
+  } else{
+    napi_throw_error(env, NULL, "Stats requires a callback function");
   }
+  return NULL;
 }
 
-void SpatialIndex::Bounds(const Nan::FunctionCallbackInfo<v8::Value>& info){
-  if (info.Length() == 1){
-    Nan::Callback *callback = new Nan::Callback(info[0].As<Function>());
-    SpatialIndex* index = ObjectWrap::Unwrap<SpatialIndex>(info.Holder());
-    if (index->handle == NULL){
-      Nan::ThrowError("Index must be open");
+napi_value queueStorage(napi_env env, napi_callback_info info, StorageOp op, const char* name){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  if (argc == 1){
+    SpatialIndex* index = unwrapIndex(env, self);
+    if (index->GetIndex() == NULL){
+      napi_throw_error(env, NULL, "Index must be open");
     } else {
-      AsyncQueueWorker(new SIDXBoundsWorker(callback, index));
+      queueIndexWorker(index, self, new SIDXStorageWorker(env, argv[0], index, op));
     }
   } else{
-    Nan::ThrowError("Bounds requires a callback function");
+    std::string msg = std::string(name) + " requires a callback function";
+    napi_throw_error(env, NULL, msg.c_str());
+  }
+  return NULL;
+}
+
+napi_value SpatialIndex::Flush(napi_env env, napi_callback_info info){
+  return queueStorage(env, info, StorageFlush, "Flush");
+}
+
+napi_value SpatialIndex::ClearBuffer(napi_env env, napi_callback_info info){
+  return queueStorage(env, info, StorageClearBuffer, "ClearBuffer");
+}
+
+napi_value SpatialIndex::Close(napi_env env, napi_callback_info info){
+  return queueStorage(env, info, StorageClose, "Close");
+}
+
+napi_value SpatialIndex::Query(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+    return NULL;
+  }
+  // mins, maxs, [chunkSize]
+  if ((argc < 2) || (argc > 3) || !isArray(env, argv[0]) || !isArray(env, argv[1])){
+    napi_throw_error(env, NULL, "Query requires min and max MBR arrays and an optional chunk size");
+    return NULL;
+  }
+  uint32_t chunkSize = 1000;
+  if (argc == 3){
+    double value = toDouble(env, argv[2]);
+    if ((typeOf(env, argv[2]) != napi_number) || (value < 1) || (value > std::numeric_limits<uint32_t>::max()) ||
+        (value != static_cast<uint32_t>(value))){
+      napi_throw_error(env, NULL, "Query chunk size must be a positive integer");
+      return NULL;
+    }
+    chunkSize = static_cast<uint32_t>(value);
+  }
+  std::vector<double> mins;
+  std::vector<double> maxs;
+
+  toArray(env, argv[0], mins);
+  toArray(env, argv[1], maxs);
+
+  napi_value cursorObj = QueryCursor::NewInstance(env);
+  QueryCursor* cursor = NULL;
+  napi_unwrap(env, cursorObj, reinterpret_cast<void**>(&cursor));
+  cursor->Start(env, cursorObj, index, self, mins, maxs, chunkSize);
+  return cursorObj;
+}
+
+// takes the read lock on the calling thread for the sync calls, which are only
+// offered for memory indexes where a query is cheaper than a worker round trip
+bool lockForSync(napi_env env, SpatialIndex* index) {
+  if (index->GetIndex() == NULL){
+    napi_throw_error(env, NULL, "Index must be open");
+    return false;
+  }
+  if (index->GetStorage() != RT_Memory){
+    napi_throw_error(env, NULL, "Sync queries require a memory index");
+    return false;
+  }
+  // never wait on the event loop, a writer may be running. Open query cursors
+  // hold nothing between reads so a sync query can run alongside them
+  if (!index->TryReadLock()){
+    napi_throw_error(env, NULL, "Index is busy, use the async call");
+    return false;
+  }
+  return true;
+}
+
+// the sync calls read the arrays in place, so a box that doesn't match the
+// index dimension is refused before anything is read or locked
+bool checkSyncBox(napi_env env, SpatialIndex* index, const std::vector<double>& mins,
+    const std::vector<double>& maxs, const char* method) {
+  if ((mins.size() != index->GetDimension()) || (maxs.size() != mins.size())){
+    std::string msg = std::string(method) + " requires arrays of the index dimension";
+    napi_throw_type_error(env, NULL, msg.c_str());
+    return false;
+  }
+  return true;
+}
+
+void throwLastError(napi_env env, const char* prefix) {
+  std::string msg = std::string(prefix) + lastError();
+  napi_throw_error(env, NULL, msg.c_str());
+}
+
+napi_value SpatialIndex::IntersectsSync(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  // mins, maxs
+  if ((argc != 2) || !isArray(env, argv[0]) || !isArray(env, argv[1])){
+    napi_throw_error(env, NULL, "IntersectsSync requires min and max MBR arrays");
+    return NULL;
+  }
+  std::vector<double> mins;
+  std::vector<double> maxs;
+
+  toArray(env, argv[0], mins);
+  toArray(env, argv[1], maxs);
+
+  if (!checkSyncBox(env, index, mins, maxs, "IntersectsSync") || !lockForSync(env, index)){
+    return NULL;
+  }
+  int64_t* ids = NULL;
+  uint64_t nResults = 0;
+  RTError r;
+  {
+    OpTimer timer(index->GetShared(), LatencyIntersects);
+    r = Index_IntersectsPaged_id(index->GetIndex(), (double*)&mins[0], (double*)&maxs[0],
+      mins.size(), 0, 0, &ids, &nResults);
+  }
+  index->ReadUnlock();
+  if (r != RT_None){
+    throwLastError(env, "Error performing Intersects: ");
+    return NULL;
+  }
+  napi_value result = toIdArray(env, ids, nResults);
+  if (ids != NULL){
+    Index_Free(ids);
+  }
+  return result;
+}
+
+napi_value SpatialIndex::NearestSync(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  // point, k
+  // point, k, maxDistance
+  if (((argc != 2) && (argc != 3)) || !isArray(env, argv[0]) || (typeOf(env, argv[1]) != napi_number)){
+    napi_throw_error(env, NULL, "NearestSync requires a point array and k, maxDistance is optional");
+    return NULL;
+  }
+  double maxDistance = std::numeric_limits<double>::infinity();
+  if (argc == 3){
+    maxDistance = toDouble(env, argv[2]);
+  }
+  std::vector<double> point;
+  toArray(env, argv[0], point);
+
+  if (!checkSyncBox(env, index, point, point, "NearestSync") || !lockForSync(env, index)){
+    return NULL;
+  }
+  int64_t* ids = NULL;
+  uint64_t nResults = toUint32(env, argv[1]);
+  RTError r;
+  {
+    OpTimer timer(index->GetShared(), LatencyNearest);
+    r = Index_NearestNeighborsWithin_id(index->GetIndex(), (double*)&point[0], (double*)&point[0],
+      point.size(), maxDistance, &ids, &nResults);
+  }
+  index->ReadUnlock();
+  if (r != RT_None){
+    throwLastError(env, "Error performing Nearest: ");
+    return NULL;
+  }
+  napi_value result = toIdArray(env, ids, nResults);
+  if (ids != NULL){
+    Index_Free(ids);
+  }
+  return result;
+}
+
+napi_value SpatialIndex::CountSync(napi_env env, napi_callback_info info){
+  napi_value argv[SIDX_MAX_ARGS];
+  napi_value self;
+  size_t argc = getArgs(env, info, argv, &self);
+  SpatialIndex* index = unwrapIndex(env, self);
+  // mins, maxs
+  if ((argc != 2) || !isArray(env, argv[0]) || !isArray(env, argv[1])){
+    napi_throw_error(env, NULL, "CountSync requires min and max MBR arrays");
+    return NULL;
+  }
+  std::vector<double> mins;
+  std::vector<double> maxs;
+
+  toArray(env, argv[0], mins);
+  toArray(env, argv[1], maxs);
+
+  if (!checkSyncBox(env, index, mins, maxs, "CountSync") || !lockForSync(env, index)){
+    return NULL;
+  }
+  uint64_t nResults = 0;
+  RTError r;
+  {
+    OpTimer timer(index->GetShared(), LatencyIntersects);
+    r = Index_Intersects_count(index->GetIndex(), (double*)&mins[0], (double*)&maxs[0],
+      mins.size(), &nResults);
+  }
+  index->ReadUnlock();
+  if (r != RT_None){
+    throwLastError(env, "Error performing Count: ");
+    return NULL;
+  }
+  return jsNumber(env, static_cast<double>(nResults));
+}
+
+QueryCursor::QueryCursor(){
+}
+
+QueryCursor::~QueryCursor() {
+  if (position != NULL) {
+    IndexPosition_Destroy(position);
+  }
+  while (!chunks.empty()) {
+    freeChunk(chunks.front());
+    chunks.pop_front();
+  }
+}
+
+void QueryCursor::Destructor(napi_env env, void* data, void* hint) {
+  QueryCursor* cursor = static_cast<QueryCursor*>(data);
+  if (cursor->holder != NULL) {
+    napi_delete_reference(env, cursor->holder);
+  }
+  delete cursor;
+}
+
+napi_value QueryCursor::Init(napi_env env) {
+  // [Symbol.asyncIterator]() returns the cursor itself
+  napi_value global;
+  napi_value symbol;
+  napi_value asyncIterator;
+  napi_get_global(env, &global);
+  napi_get_named_property(env, global, "Symbol", &symbol);
+  napi_get_named_property(env, symbol, "asyncIterator", &asyncIterator);
+
+  napi_property_descriptor properties[] = {
+    SIDX_METHOD("next", Next),
+    SIDX_METHOD("return", Return),
+    { NULL, asyncIterator, Iterator, NULL, NULL, NULL, napi_default, NULL }
+  };
+  napi_value cons;
+  napi_define_class(env, "QueryCursor", NAPI_AUTO_LENGTH, New, NULL,
+    sizeof(properties) / sizeof(properties[0]), properties, &cons);
+  return cons;
+}
+
+napi_value QueryCursor::New(napi_env env, napi_callback_info info) {
+  napi_value self;
+  napi_get_cb_info(env, info, NULL, NULL, &self, NULL);
+  QueryCursor* obj = new QueryCursor();
+  napi_wrap(env, self, obj, Destructor, NULL, NULL);
+  return self;
+}
+
+napi_value QueryCursor::NewInstance(napi_env env) {
+  napi_value cons;
+  napi_value instance;
+  napi_get_reference_value(env, getAddonData(env)->cursorConstructor, &cons);
+  napi_new_instance(env, cons, 0, NULL, &instance);
+  return instance;
+}
+
+void QueryCursor::Start(napi_env env, napi_value self, SpatialIndex* index, napi_value holder,
+    const std::vector<double>& mins, const std::vector<double>& maxs, uint32_t chunkSize) {
+  this->sidx = index;
+  napi_create_reference(env, holder, 1, &this->holder);
+  this->mins = mins;
+  this->maxs = maxs;
+  this->chunkSize = chunkSize;
+  this->position = IndexPosition_Create();
+  Fetch(env, self);
+}
+
+napi_value QueryCursor::Next(napi_env env, napi_callback_info info) {
+  napi_value self;
+  napi_get_cb_info(env, info, NULL, NULL, &self, NULL);
+  QueryCursor* cursor = NULL;
+  napi_unwrap(env, self, reinterpret_cast<void**>(&cursor));
+  napi_deferred deferred;
+  napi_value promise;
+  napi_create_promise(env, &deferred, &promise);
+  cursor->pending.push_back(deferred);
+  cursor->Drain(env);
+  cursor->Fetch(env, self);
+  return promise;
+}
+
+napi_value QueryCursor::Return(napi_env env, napi_callback_info info) {
+  napi_value self;
+  napi_get_cb_info(env, info, NULL, NULL, &self, NULL);
+  QueryCursor* cursor = NULL;
+  napi_unwrap(env, self, reinterpret_cast<void**>(&cursor));
+  cursor->Close(env);
+  napi_deferred deferred;
+  napi_value promise;
+  napi_create_promise(env, &deferred, &promise);
+  napi_resolve_deferred(env, deferred, toIteratorResult(env, jsUndefined(env), true));
+  return promise;
+}
+
+napi_value QueryCursor::Iterator(napi_env env, napi_callback_info info) {
+  napi_value self;
+  napi_get_cb_info(env, info, NULL, NULL, &self, NULL);
+  return self;
+}
+
+// reads ahead until maxChunks are queued, one worker at a time
+void QueryCursor::Fetch(napi_env env, napi_value self) {
+  if (fetching || finished || closed || (chunks.size() >= maxChunks)) {
+    return;
+  }
+  fetching = true;
+  SIDXQueryWorker* worker = new SIDXQueryWorker(env, this, sidx, mins, maxs, chunkSize, position,
+    maxChunks - chunks.size());
+  worker->SaveToPersistent("cursor", self);
+  napi_value index;
+  napi_get_reference_value(env, holder, &index);
+  queueIndexWorker(sidx, index, worker);
+}
+
+void QueryCursor::Fetched(napi_env env, napi_value self, std::deque<QueryChunk*>& fetched, bool last,
+    const std::string& msg) {
+  fetching = false;
+  while (!fetched.empty()) {
+    QueryChunk* chunk = fetched.front();
+    fetched.pop_front();
+    if (closed) {
+      freeChunk(chunk);
+    } else {
+      chunks.push_back(chunk);
+    }
+  }
+  if (last) {
+    finished = true;
+    // a closed cursor has already reported its end
+    errMsg = closed ? "" : msg;
+  }
+  Drain(env);
+  Fetch(env, self);
+}
+
+void QueryCursor::Close(napi_env env) {
+  closed = true;
+  while (!chunks.empty()) {
+    freeChunk(chunks.front());
+    chunks.pop_front();
+  }
+  Drain(env);
+}
+
+// settles pending next() promises from queued chunks, or with the end of the
+// results once the traversal has finished or the cursor was closed
+void QueryCursor::Drain(napi_env env) {
+  while (!pending.empty()) {
+    QueryChunk* chunk = NULL;
+    if (!chunks.empty()) {
+      chunk = chunks.front();
+      chunks.pop_front();
+    }
+    if ((chunk == NULL) && !finished && !closed) {
+      break;
+    }
+    napi_deferred deferred = pending.front();
+    pending.pop_front();
+    if (chunk != NULL) {
+      napi_resolve_deferred(env, deferred, toIteratorResult(env, toChunkArray(env, chunk), false));
+    } else if (!errMsg.empty()) {
+      napi_reject_deferred(env, deferred, jsError(env, errMsg));
+      errMsg.clear();
+    } else {
+      napi_resolve_deferred(env, deferred, toIteratorResult(env, jsUndefined(env), true));
+    }
   }
 }
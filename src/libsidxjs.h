@@ -19,38 +19,245 @@
 #ifndef LIBSIDXJS_H
 #define LIBSIDXJS_H
 
-#include <nan.h>
-#include <v8.h>
-#include <node.h>
+#include <node_api.h>
+#include <uv.h>
+#include <atomic>
+#include <string>
+#include <deque>
+#include <vector>
 extern "C" {
   #include <spatialindex/capi/sidx_api.h>
 }
 
-using namespace v8;
-using namespace node;
+enum LatencyOp {
+  LatencyInsert,
+  LatencyDelete,
+  LatencyIntersects,
+  LatencyNearest,
+  LatencyOps
+};
+
+// log2 histogram of operation times, bucket i counts the operations that took
+// [2^i, 2^(i+1)) microseconds, the first also counts anything quicker and the
+// last anything slower
+struct LatencyHistogram {
+  static const int buckets = 32;
+  LatencyHistogram(){
+    for (int i = 0; i < buckets; i++) {
+      counts[i].store(0);
+    }
+    totalMicros.store(0);
+  };
+  void Record(uint64_t micros){
+    int i = 0;
+    while ((i < buckets - 1) && (micros >> (i + 1)) != 0) {
+      i++;
+    }
+    counts[i]++;
+    totalMicros += micros;
+  };
+
+  std::atomic<uint64_t> counts[buckets];
+  std::atomic<uint64_t> totalMicros;
+};
 
-class SpatialIndex : public Nan::ObjectWrap {
+class SIDXWorker;
+
+// cache sizes autotune fits the tree's nodes into, 0 for the host's own
+struct CacheSizes {
+  size_t l1 = 0;
+  size_t l2 = 0;
+};
+
+// an index's own threads, so its workers don't queue behind fs and crypto on
+// libuv's pool. Queries run on the read lane and writes on the write lane,
+// which starts a write once no queries are waiting, or once the write has let
+// SIDX_WRITE_AFTER_READS queries or SIDX_WRITE_AFTER_MS go by
+class IndexExecutor {
  public:
-  static void Init(v8::Local<v8::Object> exports);
-  static void Open(const Nan::FunctionCallbackInfo<v8::Value>& info);
-  static void Version(const Nan::FunctionCallbackInfo<v8::Value>& info);
-  static void Dimension(const Nan::FunctionCallbackInfo<v8::Value>& info);
-  static void InsertData(const Nan::FunctionCallbackInfo<v8::Value>& info);
-  static void DeleteData(const Nan::FunctionCallbackInfo<v8::Value>& info);
-  static void Intersects(const Nan::FunctionCallbackInfo<v8::Value>& info);
-  static void Bounds(const Nan::FunctionCallbackInfo<v8::Value>& info);
+  explicit IndexExecutor(uint32_t readers);
+  ~IndexExecutor();
+  // main thread, the worker completes through its env's completion function
+  void Submit(SIDXWorker* worker, bool exclusive);
+  // env cleanup hook, arg is the env. Takes the env's workers off every
+  // executor and frees them, and waits for those already running to post
+  // their completions, so none runs once the env's objects are finalized
+  static void CancelAll(void* arg);
+ private:
+  static void ReadLoop(void* arg);
+  static void WriteLoop(void* arg);
+  // moves the env's queued workers to cancelled and waits for its running ones
+  void Cancel(napi_env env, std::vector<SIDXWorker*>& cancelled);
+  // the worker's env is recorded as running while it executes
+  void Run(SIDXWorker* worker);
+
+  uv_mutex_t mutex;
+  uv_cond_t readable;
+  uv_cond_t writable;
+  uv_cond_t idle;
+  std::deque<SIDXWorker*> reads;
+  std::deque<SIDXWorker*> writes;
+  std::vector<napi_env> running;
+  std::vector<uv_thread_t> threads;
+  // when the first queued write started waiting, and how many queries have
+  // started since. Once due, no query starts until the write has run
+  uint64_t writeWaitingSince = 0;
+  uint32_t readsPastWrite = 0;
+  bool writeDue = false;
+  bool stopping = false;
+};
+
+// the native index, shared by every SpatialIndex wrapping it, possibly from
+// several worker threads, and destroyed with the last reference. Workers go
+// through it rather than their thread's SpatialIndex, which may be finalized
+// with its thread while they are queued, and hold a reference until deleted
+struct SharedIndex {
+  SharedIndex();
+  ~SharedIndex();
+  void Ref(){ refs++; };
+  void Unref(){ if (--refs == 0) delete this; };
+
   void SetIndex(IndexH h){ handle = h;};
   IndexH GetIndex() const { return handle; };
   void SetProperties(IndexPropertyH p){ props = p; };
   IndexPropertyH GetProperties() const { return props; };
- private:
-  explicit SpatialIndex();
-  ~SpatialIndex();
+  void SetDimension(uint32_t d){ dims = d; };
+  uint32_t GetDimension() const { return dims; };
+  void SetType(RTIndexType t){ type = t; };
+  RTIndexType GetType() const { return type; };
+  void SetStorage(RTStorageType s){ storage = s; };
+  RTStorageType GetStorage() const { return storage; };
+  // measured on the worker threads, read on any
+  void RecordLatency(LatencyOp op, uint64_t micros){ latency[op].Record(micros); };
+  const LatencyHistogram& GetLatency(LatencyOp op) const { return latency[op]; };
+  // queries share the lock, open, insert and delete hold it exclusively
+  void ReadLock(){ uv_rwlock_rdlock(&lock); };
+  bool TryReadLock(){ return uv_rwlock_tryrdlock(&lock) == 0; };
+  void ReadUnlock(){ uv_rwlock_rdunlock(&lock); };
+  void WriteLock(){ uv_rwlock_wrlock(&lock); };
+  void WriteUnlock(){ uv_rwlock_wrunlock(&lock); };
+
   IndexH handle = NULL;
   IndexPropertyH props = NULL;
+  IndexExecutor* executor = NULL;
+  uint32_t dims = 0;
+  RTIndexType type = RT_InvalidIndexType;
+  RTStorageType storage = RT_InvalidStorageType;
+  std::atomic<uint32_t> refs{1};
+  uv_rwlock_t lock;
+  LatencyHistogram latency[LatencyOps];
+};
+
+class SpatialIndex {
+ public:
+  static napi_value Init(napi_env env, napi_value exports);
+  static napi_value BulkLoad(napi_env env, napi_callback_info info);
+  static napi_value Attach(napi_env env, napi_callback_info info);
+  static napi_value Open(napi_env env, napi_callback_info info);
+  static napi_value Share(napi_env env, napi_callback_info info);
+  static napi_value Version(napi_env env, napi_callback_info info);
+  static napi_value Dimension(napi_env env, napi_callback_info info);
+  static napi_value InsertData(napi_env env, napi_callback_info info);
+  static napi_value InsertMany(napi_env env, napi_callback_info info);
+  static napi_value DeleteData(napi_env env, napi_callback_info info);
+  static napi_value Intersects(napi_env env, napi_callback_info info);
+  static napi_value IntersectsIds(napi_env env, napi_callback_info info);
+  static napi_value IntersectsMany(napi_env env, napi_callback_info info);
+  static napi_value Nearest(napi_env env, napi_callback_info info);
+  static napi_value NearestIds(napi_env env, napi_callback_info info);
+  static napi_value Count(napi_env env, napi_callback_info info);
+  static napi_value CountMany(napi_env env, napi_callback_info info);
+  static napi_value Bounds(napi_env env, napi_callback_info info);
+  static napi_value Stats(napi_env env, napi_callback_info info);
+  static napi_value Flush(napi_env env, napi_callback_info info);
+  static napi_value ClearBuffer(napi_env env, napi_callback_info info);
+  static napi_value Close(napi_env env, napi_callback_info info);
+  static napi_value Query(napi_env env, napi_callback_info info);
+  static napi_value IntersectsSync(napi_env env, napi_callback_info info);
+  static napi_value NearestSync(napi_env env, napi_callback_info info);
+  static napi_value CountSync(napi_env env, napi_callback_info info);
+  static napi_value InsertTimed(napi_env env, napi_callback_info info);
+  static napi_value DeleteTimed(napi_env env, napi_callback_info info);
+  static napi_value IntersectsTimed(napi_env env, napi_callback_info info);
+  static napi_value InsertMoving(napi_env env, napi_callback_info info);
+  static napi_value DeleteMoving(napi_env env, napi_callback_info info);
+  static napi_value IntersectsMoving(napi_env env, napi_callback_info info);
+  SharedIndex* GetShared() const { return shared; };
+  void SetIndex(IndexH h){ shared->SetIndex(h); };
+  IndexH GetIndex() const { return shared->GetIndex(); };
+  void SetProperties(IndexPropertyH p){ shared->SetProperties(p); };
+  IndexPropertyH GetProperties() const { return shared->GetProperties(); };
+  uint32_t GetDimension() const { return shared->GetDimension(); };
+  RTIndexType GetType() const { return shared->GetType(); };
+  RTStorageType GetStorage() const { return shared->GetStorage(); };
+  void SetExecutor(IndexExecutor* e){ shared->executor = e; };
+  IndexExecutor* GetExecutor() const { return shared->executor; };
+  void SetAutotune(bool a, const CacheSizes& caches){ autotune = a; autotuneCaches = caches; };
+  bool GetAutotune() const { return autotune; };
+  const CacheSizes& GetAutotuneCaches() const { return autotuneCaches; };
+  bool TryReadLock(){ return shared->TryReadLock(); };
+  void ReadUnlock(){ shared->ReadUnlock(); };
+ private:
+  explicit SpatialIndex(SharedIndex* shared);
+  ~SpatialIndex();
+  SharedIndex* shared;
+  bool autotune = false;
+  CacheSizes autotuneCaches;
+
+  static napi_value New(napi_env env, napi_callback_info info);
+  static void Destructor(napi_env env, void* data, void* hint);
+};
+
+// a query result whose payload is owned by the item until handed to a Buffer
+struct QueryItem {
+  int64_t id;
+  char* data;
+  uint32_t length;
+};
+
+typedef std::vector<QueryItem> QueryChunk;
+
+// async iterator over the chunks of a query. The chunks are read by workers
+// that resume the traversal where the last one stopped and stop once
+// maxChunks are queued, so the index is only held while a worker runs and no
+// thread waits on JS. Everything but the workers' Execute is on the main thread
+class QueryCursor {
+ public:
+  static napi_value Init(napi_env env);
+  static napi_value NewInstance(napi_env env);
+  static napi_value Next(napi_env env, napi_callback_info info);
+  static napi_value Return(napi_env env, napi_callback_info info);
+  static napi_value Iterator(napi_env env, napi_callback_info info);
+  // queues the first read, holding the index object until the cursor is collected
+  void Start(napi_env env, napi_value self, SpatialIndex* index, napi_value holder,
+    const std::vector<double>& mins, const std::vector<double>& maxs, uint32_t chunkSize);
+  // called with a worker's chunks, last once the traversal is over
+  void Fetched(napi_env env, napi_value self, std::deque<QueryChunk*>& fetched, bool last,
+    const std::string& errMsg);
+ private:
+  explicit QueryCursor();
+  ~QueryCursor();
+  void Fetch(napi_env env, napi_value self);
+  void Drain(napi_env env);
+  void Close(napi_env env);
+
+  SpatialIndex* sidx = NULL;
+  napi_ref holder = NULL;
+  std::vector<double> mins;
+  std::vector<double> maxs;
+  uint32_t chunkSize = 0;
+  // where the last worker stopped the traversal, the next one resumes from it
+  IndexPositionH position = NULL;
+  std::deque<QueryChunk*> chunks;
+  std::deque<napi_deferred> pending;
+  size_t maxChunks = 2;
+  bool fetching = false;
+  bool closed = false;
+  bool finished = false;
+  std::string errMsg;
 
-  static void New(const Nan::FunctionCallbackInfo<v8::Value>& info);
-  static Nan::Persistent<v8::Function> constructor;
+  static napi_value New(napi_env env, napi_callback_info info);
+  static void Destructor(napi_env env, void* data, void* hint);
 };
 
 #endif
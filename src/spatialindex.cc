@@ -16,11 +16,11 @@
  * specific language governing permissions and limitations
  * under the License.
  */
-#include <nan.h>
+#include <node_api.h>
 #include "libsidxjs.h"
 
-void InitAll(v8::Local<v8::Object> exports) {
-  SpatialIndex::Init(exports);
+napi_value InitAll(napi_env env, napi_value exports) {
+  return SpatialIndex::Init(env, exports);
 }
 
-NODE_MODULE(spatialindex, InitAll)
+NAPI_MODULE(NODE_GYP_MODULE_NAME, InitAll)
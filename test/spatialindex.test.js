@@ -43,7 +43,7 @@ describe("SpatialIndex tests", function() {
   })
 
   describe("libspatialindex tests", function(done) {
-    it("Test options constructor", function(){
+    it("Test options constructor", function(done){
       var index2 = new sidx.SpatialIndex({
         "type": "rtree",
         "storage": "memory",
@@ -155,5 +155,1033 @@ describe("SpatialIndex tests", function() {
         index.insert(i, [i, i],[i, i], new Buffer(Pt), cb);
       }
     });
+
+    it ("Test intersects ids", function(done){
+      var cntr = 0;
+      var max = 10;
+      cb = function(err, result){
+        if (err){
+          done(err);
+        } else{
+          if (++cntr == max){
+            index.intersectsIds([0, 0], [10, 10], 4, 3, function(err, result){
+              if (err){
+                done(err);
+              } else{
+                expect(result.length).to.equal(3);
+                expect(Number(result[0])).to.equal(4);
+                done();
+              }
+            });
+          }
+        }
+      }
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i],[i, i], new Buffer('POINT(' + i + ' ' + i + ')'), cb);
+      }
+    });
+
+    it ("Test nearest", function(done){
+      var cntr = 0;
+      var max = 10;
+      cb = function(err, result){
+        if (err){
+          done(err);
+        } else{
+          if (++cntr == max){
+            index.nearest([4.2, 4.2], 1, function(err, result){
+              if (err){
+                done(err);
+              } else{
+                expect(result.length).to.equal(1);
+                expect(result[0].id).to.equal(4);
+                expect(result[0].data.toString()).to.equal('POINT(4 4)');
+                index.nearestIds([4.5, 4.5], 5, 1, function(err, result){
+                  if (err){
+                    done(err);
+                  } else{
+                    expect(result.length).to.equal(2);
+                    done();
+                  }
+                });
+              }
+            });
+          }
+        }
+      }
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i],[i, i], new Buffer('POINT(' + i + ' ' + i + ')'), cb);
+      }
+    });
+
+    it ("Test count", function(done){
+      var cntr = 0;
+      var max = 10;
+      cb = function(err, result){
+        if (err){
+          done(err);
+        } else{
+          if (++cntr == max){
+            index.count([0, 0], [4, 4], function(err, result){
+              if (err){
+                done(err);
+              } else{
+                expect(result).to.equal(5);
+                index.countMany(new Float64Array([0, 0, 4, 4, 8, 8, 20, 20]), function(err, result){
+                  if (err){
+                    done(err);
+                  } else{
+                    expect(result instanceof Float64Array).to.equal(true);
+                    expect(result.length).to.equal(2);
+                    expect(result[0]).to.equal(5);
+                    expect(result[1]).to.equal(2);
+                    done();
+                  }
+                });
+              }
+            });
+          }
+        }
+      }
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i],[i, i], new Buffer('POINT(' + i + ' ' + i + ')'), cb);
+      }
+    });
+
+    it ("Test insert many", function(done){
+      var max = 10;
+      var ids = new Float64Array(max);
+      var mins = new Float64Array(max * 2);
+      var maxs = new Float64Array(max * 2);
+      var offsets = new Uint32Array(max + 1);
+      var wkt = '';
+      for (var i = 0; i < max; i++){
+        ids[i] = i;
+        mins[i * 2] = maxs[i * 2] = i;
+        mins[i * 2 + 1] = maxs[i * 2 + 1] = i;
+        offsets[i] = wkt.length;
+        wkt += 'POINT(' + i + ' ' + i + ')';
+      }
+      offsets[max] = wkt.length;
+      index.insertMany(ids, mins, maxs, {offsets: offsets, data: new Buffer(wkt)}, function(err, result){
+        if (err){
+          done(err);
+        } else {
+          index.intersects([2, 2], [3, 3], function(err, result){
+            if (err){
+              done(err);
+            } else {
+              expect(result.length).to.equal(2);
+              expect(result[0].data.toString()).to.equal('POINT(' + result[0].id + ' ' + result[0].id + ')');
+              done();
+            }
+          });
+        }
+      });
+    });
+    it ("Test bulk load", function(done){
+      var max = 1000;
+      var ids = new Float64Array(max);
+      var mins = new Float64Array(max * 2);
+      var maxs = new Float64Array(max * 2);
+      var offsets = new Uint32Array(max + 1);
+      var wkt = '';
+      for (var i = 0; i < max; i++){
+        ids[i] = i;
+        mins[i * 2] = maxs[i * 2] = i;
+        mins[i * 2 + 1] = maxs[i * 2 + 1] = i;
+        offsets[i] = wkt.length;
+        wkt += 'POINT(' + i + ' ' + i + ')';
+      }
+      offsets[max] = wkt.length;
+      sidx.SpatialIndex.bulkLoad({}, {ids: ids, mins: mins, maxs: maxs, payloads: {offsets: offsets, data: new Buffer(wkt)}}, function(err, index2){
+        if (err){
+          done(err);
+        } else {
+          expect(index2.dimension()).to.equal(2);
+          index2.intersects([10, 10], [12, 12], function(err, result){
+            if (err){
+              done(err);
+            } else {
+              expect(result.length).to.equal(3);
+              expect(result[0].data.toString()).to.equal('POINT(' + result[0].id + ' ' + result[0].id + ')');
+              done();
+            }
+          });
+        }
+      });
+    });
+    it ("Test bulk load holds its arrays", function(done){
+      var max = 200000;
+      var items = {ids: new Float64Array(max), mins: new Float64Array(max * 2), maxs: new Float64Array(max * 2),
+        payloads: {offsets: new Uint32Array(max + 1), data: Buffer.alloc(max)}};
+      for (var i = 0; i < max; i++){
+        items.ids[i] = i;
+        items.mins[i * 2] = items.maxs[i * 2] = i % 1000;
+        items.mins[i * 2 + 1] = items.maxs[i * 2 + 1] = Math.floor(i / 1000);
+        items.payloads.offsets[i] = i;
+        items.payloads.data[i] = i & 0xff;
+      }
+      items.payloads.offsets[max] = max;
+      sidx.SpatialIndex.bulkLoad({}, items, function(err, index2){
+        if (err){
+          return done(err);
+        }
+        expect(index2.countSync([0, 0], [1000, 1000])).to.equal(max);
+        index2.intersects([5, 7], [5, 7], function(err, result){
+          if (!err){
+            expect(result.length).to.equal(1);
+            expect(result[0].data[0]).to.equal(7005 & 0xff);
+          }
+          done(err);
+        });
+      });
+      // the worker reads the arrays in place, dropping them here must not
+      // free them under it
+      items.ids = items.mins = items.maxs = null;
+      items.payloads.offsets = items.payloads.data = null;
+      if (global.gc){
+        global.gc();
+      }
+      var scratch = [];
+      for (var j = 0; j < 8; j++){
+        scratch.push(new Float64Array(max * 2).fill(-1));
+      }
+    });
+    it ("Test concurrent operations", function(done){
+      var max = 50;
+      var cb = 0;
+      var check = function(err, result){
+        if (err){
+          done(err);
+          return;
+        }
+        cb++;
+        if (cb == max * 2){
+          index.count([0, 0], [max, max], function(err, count){
+            if (err){
+              done(err);
+            } else {
+              expect(count).to.equal(max);
+              done();
+            }
+          });
+        }
+      };
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i], [i, i], null, check);
+        index.count([0, 0], [max, max], function(err, count){
+          if (!err){
+            expect(count).to.be.at.most(max);
+          }
+          check(err, count);
+        });
+      }
+    });
+    it ("Test concurrent paged intersects", function(done){
+      var max = 40;
+      var page = 10;
+      var cntr = 0;
+      var seen = {};
+      var pages = 0;
+      var onPage = function(err, result){
+        if (err){
+          done(err);
+          return;
+        }
+        expect(result.length).to.equal(page);
+        for (var i = 0; i < result.length; i++){
+          expect(seen[result[i].id]).to.be.undefined;
+          seen[result[i].id] = true;
+        }
+        if (++pages == max / page){
+          expect(Object.keys(seen).length).to.equal(max);
+          done();
+        }
+      };
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i], [i, i], null, function(err){
+          if (err){
+            done(err);
+          } else if (++cntr == max){
+            for (var p = 0; p < max / page; p++){
+              index.intersects([0, 0], [max, max], p * page, page, onPage);
+            }
+          }
+        });
+      }
+    });
+    it ("Test query cursor", function(done){
+      var max = 25;
+      var cntr = 0;
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i], [i, i], new Buffer('POINT(' + i + ' ' + i + ')'), function(err){
+          if (err){
+            done(err);
+          } else if (++cntr == max){
+            var cursor = index.query([0, 0], [max, max], 10);
+            var ids = [];
+            var pull = function(){
+              cursor.next().then(function(result){
+                if (result.done){
+                  expect(ids.length).to.equal(max);
+                  done();
+                } else {
+                  expect(result.value.length).to.be.at.most(10);
+                  result.value.forEach(function(item){
+                    expect(item.data.toString()).to.equal('POINT(' + item.id + ' ' + item.id + ')');
+                    ids.push(item.id);
+                  });
+                  pull();
+                }
+              }, done);
+            };
+            pull();
+          }
+        });
+      }
+    });
+    it ("Test query cursor return", function(done){
+      var max = 25;
+      var cntr = 0;
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i], [i, i], null, function(err){
+          if (err){
+            done(err);
+          } else if (++cntr == max){
+            var cursor = index.query([0, 0], [max, max], 1);
+            cursor.next().then(function(result){
+              expect(result.done).to.equal(false);
+              return cursor.return();
+            }).then(function(result){
+              expect(result.done).to.equal(true);
+              return cursor.next();
+            }).then(function(result){
+              expect(result.done).to.equal(true);
+              // the closed cursor released the index for writers
+              index.insert(max, [max, max], [max, max], null, done);
+            }).catch(done);
+          }
+        });
+      }
+    });
+    it ("Test abandoned query cursor", function(done){
+      var max = 5000;
+      var ids = new Float64Array(max);
+      var mins = new Float64Array(max * 2);
+      var maxs = new Float64Array(max * 2);
+      for (var i = 0; i < max; i++){
+        ids[i] = i;
+        mins[i * 2] = maxs[i * 2] = i;
+        mins[i * 2 + 1] = maxs[i * 2 + 1] = i;
+      }
+      index.insertMany(ids, mins, maxs, null, function(err){
+        if (err){
+          done(err);
+          return;
+        }
+        var cursor = index.query([0, 0], [max, max], 10);
+        cursor.next().then(function(result){
+          expect(result.done).to.equal(false);
+          // dropped without being drained or closed, it must not hold the index
+          cursor = null;
+          if (global.gc){
+            global.gc();
+          }
+          index.insert(max, [max, max], [max, max], null, done);
+        }).catch(done);
+      });
+    });
+    it ("Test query cursor resumes", function(done){
+      var max = 5000;
+      var ids = new Float64Array(max);
+      var mins = new Float64Array(max * 2);
+      var maxs = new Float64Array(max * 2);
+      for (var i = 0; i < max; i++){
+        ids[i] = i;
+        mins[i * 2] = maxs[i * 2] = i % 100;
+        mins[i * 2 + 1] = maxs[i * 2 + 1] = Math.floor(i / 100);
+      }
+      index.insertMany(ids, mins, maxs, null, function(err){
+        if (err){
+          done(err);
+          return;
+        }
+        var cursor = index.query([0, 0], [max, max], 7);
+        var seen = new Uint8Array(max);
+        var count = 0;
+        var pull = function(){
+          cursor.next().then(function(result){
+            if (!result.done){
+              result.value.forEach(function(item){
+                expect(seen[item.id]).to.equal(0);
+                seen[item.id] = 1;
+                count++;
+              });
+              return pull();
+            }
+            expect(count).to.equal(max);
+            index.stats(function(err, stats){
+              if (err){
+                return done(err);
+              }
+              // every read carried on where the last stopped, none went over earlier results again
+              expect(stats.queryResults).to.equal(max);
+              done();
+            });
+          }).catch(done);
+        };
+        pull();
+      });
+    });
+    it ("Test query cursor with writes between chunks", function(done){
+      var max = 5000;
+      var ids = new Float64Array(max);
+      var mins = new Float64Array(max * 2);
+      var maxs = new Float64Array(max * 2);
+      // every id is given to two items, which the cursor must tell apart
+      for (var i = 0; i < max; i++){
+        ids[i] = i % (max / 2);
+        mins[i * 2] = maxs[i * 2] = i % 100;
+        mins[i * 2 + 1] = maxs[i * 2 + 1] = Math.floor(i / 100);
+      }
+      index.insertMany(ids, mins, maxs, null, function(err){
+        if (err){
+          done(err);
+          return;
+        }
+        var cursor = index.query([0, 0], [max, max], 50);
+        var seen = {};
+        var extra = max;
+        var count = 0;
+        // the items inserted between chunks, deleted again a few chunks later
+        var at = function(id){
+          return [(id * 37) % 100, (id * 11) % 50];
+        };
+        var write = function(){
+          var id = extra++;
+          var p = at(id);
+          return new Promise(function(resolve, reject){
+            index.insert(id, p, p, null, function(err){
+              if (err){
+                return reject(err);
+              }
+              if (id - max < 3){
+                return resolve();
+              }
+              var old = at(id - 3);
+              index.delete(id - 3, old, old, function(err){
+                err ? reject(err) : resolve();
+              });
+            });
+          });
+        };
+        var pull = function(){
+          cursor.next().then(function(result){
+            if (!result.done){
+              result.value.forEach(function(item){
+                seen[item.id] = (seen[item.id] || 0) + 1;
+                expect(seen[item.id]).to.be.at.most(item.id < max ? 2 : 1);
+                if (item.id < max){
+                  count++;
+                }
+              });
+              return write().then(pull);
+            }
+            // every item there from start to end came back exactly once
+            expect(count).to.equal(max);
+            done();
+          }).catch(done);
+        };
+        pull();
+      });
+    });
+    it ("Test sync queries", function(done){
+      var max = 10;
+      var cntr = 0;
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i], [i, i], null, function(err){
+          if (err){
+            done(err);
+          } else if (++cntr == max){
+            expect(index.countSync([0, 0], [4, 4])).to.equal(5);
+            var ids = index.intersectsSync([2, 2], [3, 3]);
+            expect(ids.length).to.equal(2);
+            ids = index.nearestSync([5.1, 5.1], 2);
+            expect(ids.length).to.equal(2);
+            expect(Number(ids[0])).to.equal(5);
+            expect(index.nearestSync([5.1, 5.1], 5, 1).length).to.equal(1);
+            // boxes of the wrong dimension are refused rather than read past their end
+            expect(function(){ index.intersectsSync([0, 0], [1]); }).to.throw(TypeError);
+            expect(function(){ index.countSync([], []); }).to.throw(TypeError);
+            expect(function(){ index.nearestSync([5], 1); }).to.throw(TypeError);
+            done();
+          }
+        });
+      }
+    });
+    it ("Test NaN query coordinates", function(done){
+      var max = 2000;
+      var ids = new Float64Array(max);
+      var mins = new Float64Array(max * 2);
+      var maxs = new Float64Array(max * 2);
+      for (var i = 0; i < max; i++){
+        ids[i] = i;
+        mins[i * 2] = maxs[i * 2] = i % 100;
+        mins[i * 2 + 1] = maxs[i * 2 + 1] = Math.floor(i / 100);
+      }
+      index.insertMany(ids, mins, maxs, null, function(err){
+        if (err){
+          return done(err);
+        }
+        // a NaN bound never rules anything out, on every node of the tree
+        expect(index.countSync([-Infinity, 0], [Infinity, 4])).to.equal(500);
+        expect(index.countSync([NaN, 0], [NaN, 4])).to.equal(500);
+        expect(index.countSync([NaN, NaN], [NaN, NaN])).to.equal(max);
+        expect(index.intersectsSync([10, NaN], [19, NaN]).length).to.equal(200);
+        done();
+      });
+    });
+    it ("Test shared index", function(done){
+      var Worker = require('worker_threads').Worker;
+      var max = 10;
+      var cntr = 0;
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i], [i, i], buf, function(err){
+          if (err){
+            done(err);
+          } else if (++cntr == max){
+            var token = index.share();
+            var worker = new Worker(
+              "var sidx = require('bindings')('spatialindex');" +
+              "var wt = require('worker_threads');" +
+              "var shared = sidx.SpatialIndex.attach(wt.workerData);" +
+              "shared.intersectsIds([0, 0], [4, 4], function(err, ids){" +
+              "  wt.parentPort.postMessage(err ? err.message : ids.length);" +
+              "});", {eval: true, workerData: token});
+            worker.on('error', done);
+            worker.on('message', function(count){
+              expect(count).to.equal(5);
+              var again;
+              try {
+                sidx.SpatialIndex.attach(token);
+              } catch (e){
+                again = e;
+              }
+              expect(again instanceof Error).to.equal(true);
+              done();
+            });
+          }
+        });
+      }
+    });
+    it ("Test terminated worker with queued executor work", function(done){
+      var Worker = require('worker_threads').Worker;
+      var threaded = new sidx.SpatialIndex({"threads": 1});
+      var rounds = 20;
+      var max = 5000;
+      threaded.open(function(err){
+        if (err){
+          return done(err);
+        }
+        var round = function(r){
+          if (r == rounds){
+            // the terminated threads' queued queries neither ran against their
+            // freed objects nor kept the index from serving this thread
+            threaded.count([0, 0], [max, max], function(err, count){
+              if (err){
+                return done(err);
+              }
+              expect(count).to.equal(max);
+              done();
+            });
+            return;
+          }
+          var worker = new Worker(
+            "var sidx = require('bindings')('spatialindex');" +
+            "var wt = require('worker_threads');" +
+            "var shared = sidx.SpatialIndex.attach(wt.workerData);" +
+            "for (var i = 0; i < 300; i++){" +
+            "  shared.intersectsIds([0, 0], [" + max + ", " + max + "], function(){});" +
+            "}" +
+            "wt.parentPort.postMessage('queued');", {eval: true, workerData: threaded.share()});
+          worker.on('error', done);
+          worker.on('message', function(){
+            worker.terminate();
+          });
+          worker.on('exit', function(){
+            round(r + 1);
+          });
+        };
+        // enough items that the queries are still queued when the thread goes
+        var ids = new Float64Array(max);
+        var mins = new Float64Array(max * 2);
+        for (var i = 0; i < max; i++){
+          ids[i] = i;
+          mins[i * 2] = i % 100;
+          mins[i * 2 + 1] = Math.floor(i / 100);
+        }
+        threaded.insertMany(ids, mins, mins, null, function(err){
+          if (err){
+            return done(err);
+          }
+          round(0);
+        });
+      });
+    });
+    it ("Test attach on the same thread", function(done){
+      index.insert(1, [1, 1], [1, 1], buf, function(err){
+        if (err){
+          return done(err);
+        }
+        // attach() is the only way in for a shared index, the constructor
+        // still builds a fresh one afterwards
+        var shared = sidx.SpatialIndex.attach(index.share());
+        expect(shared.countSync([0, 0], [2, 2])).to.equal(1);
+        var fresh = new sidx.SpatialIndex();
+        fresh.open(function(err){
+          if (err){
+            return done(err);
+          }
+          expect(fresh.countSync([0, 0], [2, 2])).to.equal(0);
+          done();
+        });
+      });
+    });
+    it ("Test intersects many", function(done){
+      var max = 10;
+      var cntr = 0;
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i], [i, i], buf, function(err){
+          if (err){
+            done(err);
+          } else if (++cntr == max){
+            var boxes = new Float64Array([0, 0, 4, 4, 8, 8, 20, 20, 5, 5, 5, 5, 100, 100, 200, 200]);
+            index.intersectsMany(boxes, function(err, result){
+              if (err){
+                done(err);
+              } else {
+                expect(Array.from(result.offsets).join()).to.equal('0,5,7,8,8');
+                expect(result.ids.length).to.equal(8);
+                expect(Number(result.ids[7])).to.equal(5);
+                done();
+              }
+            });
+          }
+        });
+      }
+    });
+    it ("Test intersects many with unbounded boxes", function(done){
+      var max = 10;
+      var cntr = 0;
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i], [i, i], buf, function(err){
+          if (err){
+            done(err);
+          } else if (++cntr == max){
+            var boxes = new Float64Array([0, 0, 4, 4, -Infinity, -Infinity, Infinity, Infinity,
+              5, 5, Infinity, Infinity, -1.7e308, -1.7e308, 1.7e308, 1.7e308, 8, 8, 20, 20]);
+            index.intersectsMany(boxes, function(err, result){
+              if (err){
+                done(err);
+              } else {
+                // the unbounded boxes are ordered among the others and still match everything
+                expect(Array.from(result.offsets).join()).to.equal('0,5,15,20,30,32');
+                expect(Array.from(result.ids.slice(30), Number).sort().join()).to.equal('8,9');
+                done();
+              }
+            });
+          }
+        });
+      }
+    });
+    it ("Test mvrtree", function(done){
+      var mvr = new sidx.SpatialIndex({"type": "mvrtree"});
+      mvr.open(function(err){
+        if (err){
+          return done(err);
+        }
+        mvr.insertTimed(1, [0, 0], [1, 1], 0, 0, buf, function(err){
+          if (err){
+            return done(err);
+          }
+          mvr.insertTimed(2, [5, 5], [6, 6], 5, 5, function(err){
+            if (err){
+              return done(err);
+            }
+            mvr.deleteTimed(1, [0, 0], [1, 1], 0, 10, function(err){
+              if (err){
+                return done(err);
+              }
+              mvr.intersectsTimed([0, 0], [10, 10], 12, 15, function(err, result){
+                if (err){
+                  return done(err);
+                }
+                expect(result.length).to.equal(1);
+                expect(result[0].id).to.equal(2);
+                mvr.intersectsTimed([0, 0], [10, 10], 0, 4, function(err, result){
+                  if (err){
+                    return done(err);
+                  }
+                  expect(result.length).to.equal(1);
+                  expect(result[0].id).to.equal(1);
+                  expect(result[0].data.toString()).to.equal(buf.toString());
+                  done();
+                });
+              });
+            });
+          });
+        });
+      });
+    });
+    it ("Test tprtree", function(done){
+      var tpr = new sidx.SpatialIndex({"type": "tprtree", "horizon": 100});
+      tpr.open(function(err){
+        if (err){
+          return done(err);
+        }
+        tpr.insertMoving(1, [0, 0], [0, 0], [1, 1], [1, 1], 0, 100, function(err){
+          if (err){
+            return done(err);
+          }
+          tpr.intersectsMoving([9, 9], [11, 11], [0, 0], [0, 0], 10, 11, function(err, result){
+            if (err){
+              return done(err);
+            }
+            expect(result.length).to.equal(1);
+            tpr.intersectsMoving([50, 50], [51, 51], [0, 0], [0, 0], 1, 2, function(err, result){
+              if (err){
+                return done(err);
+              }
+              expect(result.length).to.equal(0);
+              done();
+            });
+          });
+        });
+      });
+    });
+    it ("Test bulk load temporal types", function(done){
+      var ids = new Float64Array([1, 2]);
+      var mins = new Float64Array([0, 0, 1, 1]);
+      var cntr = 0;
+      ["mvrtree", "tprtree"].forEach(function(type){
+        sidx.SpatialIndex.bulkLoad({"type": type}, {ids: ids, mins: mins, maxs: mins}, function(err, index2){
+          expect(err instanceof Error).to.equal(true);
+          expect(err.message).to.equal("Error bulk loading Index: only rtree indexes can be bulk loaded");
+          if (++cntr == 2){
+            done();
+          }
+        });
+      });
+    });
+    it ("Test tuning options", function(done){
+      var bad = new sidx.SpatialIndex({"fillFactor": 2});
+      bad.open(function(err){
+        expect(err instanceof Error).to.equal(true);
+        var max = 2000;
+        var ids = new Float64Array(max);
+        var mins = new Float64Array(max * 2);
+        for (var i = 0; i < max; i++){
+          ids[i] = i;
+          mins[i * 2] = mins[i * 2 + 1] = i;
+        }
+        var options = {"leafCapacity": 20, "indexCapacity": 20, "fillFactor": 0.9, "bufferingCapacity": 20,
+          "leafPoolCapacity": 200, "indexPoolCapacity": 200, "autotune": true};
+        sidx.SpatialIndex.bulkLoad(options, {ids: ids, mins: mins, maxs: mins}, function(err, index2){
+          if (err){
+            return done(err);
+          }
+          index2.count([10, 10], [19, 19], function(err, count){
+            if (err){
+              return done(err);
+            }
+            expect(count).to.equal(10);
+            done();
+          });
+        });
+      });
+    });
+    it ("Test autotune cache sizes", function(done){
+      expect(function(){ new sidx.SpatialIndex({"autotune": {"l2": -1}}); }).to.throw("Invalid option autotune");
+      var max = 20000;
+      var ids = new Float64Array(max);
+      var mins = new Float64Array(max * 2);
+      for (var i = 0; i < max; i++){
+        ids[i] = i;
+        mins[i * 2] = i % 200;
+        mins[i * 2 + 1] = Math.floor(i / 200);
+      }
+      // a tiny L1 only fits 16 entry nodes, a tiny L2 pushes the leaves as
+      // large as they go to shrink the levels above them
+      sidx.SpatialIndex.bulkLoad({"autotune": {"l1": 512, "l2": 1 << 30}}, {ids: ids, mins: mins, maxs: mins}, function(err, small){
+        if (err){
+          return done(err);
+        }
+        sidx.SpatialIndex.bulkLoad({"autotune": {"l1": 1 << 20, "l2": 4096}}, {ids: ids, mins: mins, maxs: mins}, function(err, large){
+          if (err){
+            return done(err);
+          }
+          small.stats(function(err, smallStats){
+            if (err){
+              return done(err);
+            }
+            large.stats(function(err, largeStats){
+              if (err){
+                return done(err);
+              }
+              expect(smallStats.data).to.equal(max);
+              expect(largeStats.data).to.equal(max);
+              expect(smallStats.nodes > 10 * largeStats.nodes).to.equal(true);
+              expect(small.countSync([10, 10], [19, 19])).to.equal(100);
+              expect(large.countSync([10, 10], [19, 19])).to.equal(100);
+              done();
+            });
+          });
+        });
+      });
+    });
+    it ("Test stats", function(done){
+      var max = 50;
+      var cntr = 0;
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i], [i, i], buf, function(err){
+          if (err){
+            done(err);
+          } else if (++cntr == max){
+            index.intersects([0, 0], [9, 9], function(err){
+              if (err){
+                return done(err);
+              }
+              index.stats(function(err, stats){
+                if (err){
+                  return done(err);
+                }
+                expect(stats.data).to.equal(max);
+                expect(stats.nodesInLevel.length).to.equal(stats.treeHeight);
+                expect(stats.latency.insert.count).to.equal(max);
+                expect(stats.latency.intersects.count).to.equal(1);
+                expect(stats.latency.nearest.count).to.equal(0);
+                expect(stats.latency.insert.buckets.length).to.equal(32);
+                done();
+              });
+            });
+          }
+        });
+      }
+    });
+    it ("Test flush and close", function(done){
+      var os = require('os');
+      var fs = require('fs');
+      var filename = os.tmpdir() + '/nodesidx-flush-' + process.pid;
+      var disk = new sidx.SpatialIndex({"storage": "disk", "filename": filename});
+      var cleanup = function(err){
+        [".idx", ".dat"].forEach(function(ext){
+          try { fs.unlinkSync(filename + ext); } catch (e) {}
+        });
+        done(err);
+      };
+      disk.open(function(err){
+        if (err){
+          return cleanup(err);
+        }
+        disk.insert(1, [0, 0], [1, 1], buf, function(err){
+          if (err){
+            return cleanup(err);
+          }
+          disk.flush(function(err){
+            if (err){
+              return cleanup(err);
+            }
+            disk.stats(function(err, flushed){
+              if (err){
+                return cleanup(err);
+              }
+              // flushing writes the dirty pages back but keeps the buffer warm
+              disk.count([0, 0], [1, 1], function(err, count){
+                if (err){
+                  return cleanup(err);
+                }
+                expect(count).to.equal(1);
+                disk.stats(function(err, queried){
+                  if (err){
+                    return cleanup(err);
+                  }
+                  expect(queried.bufferHits > flushed.bufferHits).to.equal(true);
+                  disk.clearBuffer(function(err){
+                    if (err){
+                      return cleanup(err);
+                    }
+                    disk.close(function(err){
+                      if (err){
+                        return cleanup(err);
+                      }
+                      expect(function(){ disk.count([0, 0], [1, 1], function(){}); }).to.throw("Index must be open");
+                      expect(function(){ disk.flush(function(){}); }).to.throw("Index must be open");
+                      var reopened = new sidx.SpatialIndex({"storage": "disk", "filename": filename,
+                        "overwrite": false, "indexId": 1});
+                      reopened.open(function(err){
+                        if (err){
+                          return cleanup(err);
+                        }
+                        reopened.count([0, 0], [1, 1], function(err, count){
+                          if (!err){
+                            expect(count).to.equal(1);
+                          }
+                          reopened.close(function(){
+                            cleanup(err);
+                          });
+                        });
+                      });
+                    });
+                  });
+                });
+              });
+            });
+          });
+        });
+      });
+    });
+    it ("Test executor threads", function(done){
+      expect(function(){ new sidx.SpatialIndex({"threads": -1}); }).to.throw("Invalid option threads");
+      var pooled = new sidx.SpatialIndex({"threads": 2});
+      var max = 200;
+      var cntr = 0;
+      var queries = 0;
+      pooled.open(function(err){
+        if (err){
+          return done(err);
+        }
+        for (var i = 0; i < max; i++){
+          pooled.insert(i, [i, i], [i, i], buf, function(err){
+            if (err){
+              return done(err);
+            }
+            if (++cntr == max){
+              for (var q = 0; q < 10; q++){
+                pooled.count([0, 0], [max, max], function(err, count){
+                  if (err){
+                    return done(err);
+                  }
+                  expect(count).to.equal(max);
+                  if (++queries == 10){
+                    pooled.intersects([0, 0], [9, 9], function(err, results){
+                      if (!err){
+                        expect(results.length).to.equal(10);
+                      }
+                      done(err);
+                    });
+                  }
+                });
+              }
+            }
+          });
+        }
+      });
+    });
+    it ("Test writes behind a query stream", function(done){
+      var pooled = new sidx.SpatialIndex({"threads": 2});
+      var max = 20000;
+      var ids = new Float64Array(max);
+      var mins = new Float64Array(max * 2);
+      var maxs = new Float64Array(max * 2);
+      for (var i = 0; i < max; i++){
+        ids[i] = i;
+        mins[i * 2] = maxs[i * 2] = i % 200;
+        mins[i * 2 + 1] = maxs[i * 2 + 1] = Math.floor(i / 200);
+      }
+      pooled.open(function(err){
+        if (err){
+          return done(err);
+        }
+        pooled.insertMany(ids, mins, maxs, null, function(err){
+          if (err){
+            return done(err);
+          }
+          // keep queries queued the whole time, the insert still has to run
+          var inserted = false;
+          var running = 0;
+          function query(){
+            running++;
+            pooled.count([0, 0], [200, 100], function(err, count){
+              running--;
+              if (err){
+                return done(err);
+              }
+              if (!inserted){
+                query();
+              } else if (running == 0){
+                done();
+              }
+            });
+          }
+          for (var q = 0; q < 64; q++){
+            query();
+          }
+          pooled.insert(max, [50, 50], [50, 50], buf, function(err){
+            if (err){
+              return done(err);
+            }
+            inserted = true;
+          });
+        });
+      });
+    });
+    it ("Test concurrent errors", function(done){
+      var mvr = new sidx.SpatialIndex({"type": "mvrtree", "threads": 4});
+      var tpr = new sidx.SpatialIndex({"type": "tprtree", "threads": 4});
+      var max = 50;
+      var cntr = 0;
+      var check = function(expected){
+        return function(err){
+          expect(err.message.indexOf(expected) >= 0).to.equal(true);
+          if (++cntr == 2 * max){
+            done();
+          }
+        };
+      };
+      mvr.open(function(err){
+        if (err){
+          return done(err);
+        }
+        tpr.open(function(err){
+          if (err){
+            return done(err);
+          }
+          mvr.insertTimed(1, [0, 0], [1, 1], 10, 20, buf, function(err){
+            if (err){
+              return done(err);
+            }
+            for (var i = 0; i < max; i++){
+              // older than the tree's current time
+              mvr.insertTimed(i + 2, [0, 0], [1, 1], 5, 20, buf, check("older than tree current time"));
+              tpr.intersectsMoving([0, 0], [1, 1], [0, 0], [0, 0], 5, 5, check("degenerate time intervals"));
+            }
+          });
+        });
+      });
+    });
+    it ("Test sync queries with an open cursor", function(done){
+      var max = 25;
+      var cntr = 0;
+      for (var i = 0; i < max; i++){
+        index.insert(i, [i, i], [i, i], null, function(err){
+          if (err){
+            done(err);
+          } else if (++cntr == max){
+            var cursor = index.query([0, 0], [max, max], 1);
+            cursor.next().then(function(result){
+              expect(result.done).to.equal(false);
+              // the cursor holds nothing between reads
+              expect(index.intersectsSync([0, 0], [max, max]).length).to.equal(max);
+              expect(index.countSync([0, 0], [4, 4])).to.equal(5);
+              return cursor.return();
+            }).then(function(result){
+              expect(result.done).to.equal(true);
+              done();
+            }).catch(done);
+          }
+        });
+      }
+    });
   });
 });